@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "gurobi_c.h"
 #include "board.h"
+#include "solver_context.h"
 #include "error_handler.h"
 
 #define CONST_ROW_AND_COL 0
@@ -75,23 +76,26 @@ void free_var_index_map(int b_len, int ***map){
 /*Returns a board with the solution array sol applied to it*/
 game_board sol_to_board(game_board *source, double *sol, int ***var_index_map){
 	game_board solution;
-	int i,j,k,len;
-	solution = create_board(source->block_rows,source->block_columns);
+	int i,j,k,len,*values;
 	len = board_len(source);
+	values = (int*)calloc(len*len,sizeof(int));
+	if(values == NULL) function_error(f_calloc);
 	for(i = 0; i < len; ++i){
 		for(j = 0; j < len; ++j){
 			if(source->cells[i][j].value != 0){ /*if source has cell set - keep the same value*/
-				set_cell(&solution,i,j,source->cells[i][j].value);
+				values[j*len+i] = source->cells[i][j].value;
 			}else{ /*else - search for correct value according to the solution*/
 				for(k = 0; k < len; ++k){
 					if(var_index_map[i][j][k] != -1 && sol[var_index_map[i][j][k]] > 0.5){ /*if (i,j,k) is a var and is 1 in the solution*/
-						set_cell(&solution,i,j,k+1);
+						values[j*len+i] = k+1;
 						break;
 					}
 				}
 			}
 		}
 	}
+	solution = board_from_cells(source->block_rows,source->block_columns,values,NULL);
+	free(values);
 	return solution;
 }
 
@@ -150,10 +154,25 @@ void get_constraint(game_board *board, int **constraint, char mode, int const1,
 	}
 }
 
-/*setup the gurobi environment and model*/
-void gurobi_setup( GRBenv** env, GRBmodel** model) {
+/*Counts the steps of the optimization and stops it once the context was cancelled,
+ * called by gurobi periodically while it runs*/
+int __stdcall cancel_callback(GRBmodel *model, void *cbdata, int where, void *usrdata){
+	solver_context *ctx = (solver_context*)usrdata;
+	(void)cbdata;
+	(void)where;
+	ctx->steps++;
+	if(ctx->cancelled){
+		ctx->aborted=1;
+		GRBterminate(model);
+	}
+	return 0;
+}
+
+/*setup the gurobi environment and model
+ * No log file is kept, so models may be solved in several threads at once*/
+void gurobi_setup( GRBenv** env, GRBmodel** model, solver_context *ctx) {
 	int error;
-	error = GRBloadenv(env, "mip1.log");
+	error = GRBloadenv(env, NULL);
 	if (error) {
 		printf("Error: GRBloadenv has failed\n");
 	}
@@ -165,6 +184,10 @@ void gurobi_setup( GRBenv** env, GRBmodel** model) {
 	if (error) {
 		printf("Error: GRBsetintparam has failed\n");
 	}
+	error = GRBsetcallbackfunc(*model, cancel_callback, ctx);
+	if (error) {
+		printf("Error: GRBsetcallbackfunc has failed\n");
+	}
 }
 
 /*solve the gorubi model*/
@@ -178,10 +201,6 @@ void gurobi_solve_model(GRBmodel* model, int* optimstatus) {
 	if (error) {
 		printf("Error: GRBoptimize has failed\n");
 	}
-	error = GRBwrite(model, "mip1.lp");
-	if (error) {
-		printf("Error: GRBwrite has failed\n");
-	}
 	error = GRBgetintattr(model, GRB_INT_ATTR_STATUS, &*optimstatus);
 	if (error) {
 		printf("Error: GRBgetintattr has failed\n");
@@ -248,9 +267,9 @@ void gurobi_add_vars(int var_count,GRBmodel** model,double* val) {
 }
 
 /* Returns a solved board that begins in the same state as source
- * if no solution is found - returns a 0x0 board
+ * if no solution is found, or ctx was cancelled - returns a 0x0 board
  */
-game_board find_solution(game_board *source){
+game_board find_solution(solver_context *ctx, game_board *source){
 	game_board solution;
 	GRBenv   *env   = NULL;
 	GRBmodel *model = NULL;
@@ -262,7 +281,7 @@ game_board find_solution(game_board *source){
 	int var_count;
 
 
-	gurobi_setup( &env, &model);
+	gurobi_setup( &env, &model, ctx);
 
 	var_index_map = get_var_index_map(source,&var_count);
 
@@ -276,7 +295,7 @@ game_board find_solution(game_board *source){
 	gurobi_add_vars(var_count,&model,val);
 	add_soduko_contraints(source, var_index_map, &ind, &model, &val);
 	gurobi_solve_model(model, &optimstatus);
-	if(optimstatus == GRB_INFEASIBLE){
+	if(optimstatus == GRB_INFEASIBLE || optimstatus == GRB_INTERRUPTED){
 		solution.block_columns = 0;
 		solution.block_rows = 0;
 
@@ -298,9 +317,9 @@ game_board find_solution(game_board *source){
 
 /*Returns 1 if the board is solvable, else returns 0*/
 
-char is_solvable(game_board* board){
+char is_solvable(solver_context *ctx, game_board* board){
 	char solvable;
-	game_board temp = find_solution(board);
+	game_board temp = find_solution(ctx,board);
 	solvable = (temp.block_columns != 0);
 	if(solvable){
 		free_board(&temp);
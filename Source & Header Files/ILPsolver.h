@@ -1,6 +1,7 @@
 /*This module implements the ILP solution algorithm
  * using Gurobi Optimizer*/
 
+#include "solver_context.h"
 
-game_board find_solution(game_board *source);
-char is_solvable(game_board* board);
+game_board find_solution(solver_context *ctx, game_board *source);
+char is_solvable(solver_context *ctx, game_board* board);
@@ -0,0 +1,433 @@
+/*This module handles compressed archives of boards, see archive.h for the layout*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "board.h"
+#include "error_handler.h"
+#include "binary_format.h"
+#include "lz_codec.h"
+#include "archive.h"
+
+#define ARCHIVE_MAGIC "SDKZ"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_HEADER_SIZE 24
+#define INDEX_ENTRY_SIZE 24
+#define CHUNK_SIZE 65536 /*A chunk is closed once its records take this many bytes*/
+#define INITIAL_CHUNKS 64
+#define MAX_RATIO 255 /*No valid chunk decompresses to more than this many times its size*/
+#define CHUNKS_PER_THREAD 2 /*Chunks a reader's worker may decompress ahead*/
+
+/*An enum for the states of a chunk slot of a reader*/
+typedef enum chunk_state{
+	chunk_free,chunk_busy,chunk_ready,chunk_damaged
+} chunk_state;
+
+/*A struct that describes a chunk, as kept in the index*/
+typedef struct chunk_info{
+	unsigned long offset,packed_size,raw_size,first,count;
+} chunk_info;
+
+struct archive_writer{
+	FILE *file;
+	unsigned char *raw; /*Records of the current chunk*/
+	size_t raw_size,raw_capacity;
+	unsigned char *packed; /*The current chunk compressed*/
+	size_t packed_capacity;
+	unsigned char *index; /*Entries of the chunks written so far*/
+	unsigned long chunks,index_capacity;
+	unsigned long boards; /*Boards added so far*/
+	unsigned long first; /*Number of the first board of the current chunk*/
+	unsigned long position; /*Bytes written so far*/
+};
+
+/*A struct that holds a chunk on its way from a worker to the reader*/
+typedef struct chunk_slot{
+	unsigned char *raw,*packed;
+	size_t raw_capacity,packed_capacity,raw_size;
+	chunk_state state;
+} chunk_slot;
+
+struct archive_reader{
+	int fd;
+	unsigned long size; /*Size of the file*/
+	unsigned long chunks;
+	unsigned char *index;
+	chunk_slot *slots; /*Chunk number c is kept in slots[c%window]*/
+	int window;
+	unsigned long claimed; /*Chunks taken by the workers so far*/
+	unsigned long current; /*The chunk the reader is in*/
+	size_t position; /*Position of the next record in the current chunk*/
+	char started; /*Set once the reader entered the first chunk*/
+	char stop; /*Set when the workers should exit*/
+	pthread_t *workers;
+	int worker_count;
+	pthread_mutex_t lock;
+	pthread_cond_t chunk_done,slot_freed;
+};
+
+/*Returns 1 if the path has the archive extension*/
+char is_archive_path(char *path){
+	size_t len=strlen(path),ext_len=strlen(ARCHIVE_EXTENSION);
+	return len>ext_len && !strcmp(path+len-ext_len,ARCHIVE_EXTENSION);
+}
+
+/*Writes the header of an archive*/
+void encode_archive_header(unsigned char *buffer, unsigned long boards, unsigned long chunks, unsigned long index_offset){
+	memcpy(buffer,ARCHIVE_MAGIC,4);
+	encode_number(buffer+4,ARCHIVE_VERSION,4);
+	encode_number(buffer+8,boards,4);
+	encode_number(buffer+12,chunks,4);
+	encode_number(buffer+16,index_offset,8);
+}
+
+/*Writes the index entry of a chunk*/
+void encode_chunk_info(unsigned char *buffer, chunk_info *c){
+	encode_number(buffer,c->offset,8);
+	encode_number(buffer+8,c->packed_size,4);
+	encode_number(buffer+12,c->raw_size,4);
+	encode_number(buffer+16,c->first,4);
+	encode_number(buffer+20,c->count,4);
+}
+
+/*Reads the index entry of a chunk*/
+void decode_chunk_info(unsigned char *buffer, chunk_info *c){
+	c->offset=decode_number(buffer,8);
+	c->packed_size=decode_number(buffer+8,4);
+	c->raw_size=decode_number(buffer+12,4);
+	c->first=decode_number(buffer+16,4);
+	c->count=decode_number(buffer+20,4);
+}
+
+/*Makes sure the buffer holds at least size bytes*/
+void reserve(unsigned char **buffer, size_t *capacity, size_t size){
+	if(size<=*capacity)
+		return;
+	free(*buffer);
+	*buffer=(unsigned char*)malloc(size);
+	if(*buffer==NULL) function_error(f_malloc);
+	*capacity=size;
+}
+
+/*Starts an archive in file, the header is rewritten once the index is written*/
+archive_writer *create_archive_writer(FILE *file){
+	archive_writer *w;
+	unsigned char header[ARCHIVE_HEADER_SIZE];
+	w=(archive_writer*)calloc(1,sizeof(archive_writer));
+	if(w==NULL) function_error(f_calloc);
+	w->file=file;
+	encode_archive_header(header,0,0,0);
+	if(fwrite(header,1,ARCHIVE_HEADER_SIZE,file)!=ARCHIVE_HEADER_SIZE) function_error(f_fprintf);
+	w->position=ARCHIVE_HEADER_SIZE;
+	return w;
+}
+
+/*Compresses and writes the current chunk, if it has any records*/
+void flush_chunk(archive_writer *w){
+	chunk_info c;
+	if(!w->raw_size)
+		return;
+	reserve(&w->packed,&w->packed_capacity,lz_bound(w->raw_size));
+	c.offset=w->position;
+	c.packed_size=lz_compress(w->raw,w->raw_size,w->packed);
+	c.raw_size=w->raw_size;
+	c.first=w->first;
+	c.count=w->boards-w->first;
+	if(fwrite(w->packed,1,c.packed_size,w->file)!=c.packed_size) function_error(f_fprintf);
+	if(w->chunks==w->index_capacity){
+		w->index_capacity=w->index_capacity?w->index_capacity*2:INITIAL_CHUNKS;
+		w->index=(unsigned char*)realloc(w->index,w->index_capacity*INDEX_ENTRY_SIZE);
+		if(w->index==NULL) function_error(f_malloc);
+	}
+	encode_chunk_info(w->index+w->chunks*INDEX_ENTRY_SIZE,&c);
+	w->chunks++;
+	w->position+=c.packed_size;
+	w->first=w->boards;
+	w->raw_size=0;
+}
+
+/*Adds the board to the current chunk, which is written once it is full*/
+char archive_add(archive_writer *w, game_board *board){
+	size_t size=binary_record_size(board);
+	unsigned char *raw;
+	if(!size)
+		return 0;
+	if(w->raw_size+size>w->raw_capacity){
+		w->raw_capacity=w->raw_size+size>CHUNK_SIZE?w->raw_size+size:CHUNK_SIZE;
+		raw=(unsigned char*)realloc(w->raw,w->raw_capacity);
+		if(raw==NULL) function_error(f_malloc);
+		w->raw=raw;
+	}
+	encode_board(board,w->raw+w->raw_size);
+	w->raw_size+=size;
+	w->boards++;
+	if(w->raw_size>=CHUNK_SIZE)
+		flush_chunk(w);
+	return 1;
+}
+
+/*Writes the last chunk, the index and the header, and frees the writer*/
+void finish_archive(archive_writer *w){
+	unsigned char header[ARCHIVE_HEADER_SIZE];
+	flush_chunk(w);
+	if(fwrite(w->index,1,w->chunks*INDEX_ENTRY_SIZE,w->file)!=w->chunks*INDEX_ENTRY_SIZE) function_error(f_fprintf);
+	encode_archive_header(header,w->boards,w->chunks,w->position);
+	if(fseek(w->file,0,SEEK_SET)) function_error(f_fseek);
+	if(fwrite(header,1,ARCHIVE_HEADER_SIZE,w->file)!=ARCHIVE_HEADER_SIZE) function_error(f_fprintf);
+	free(w->raw);
+	free(w->packed);
+	free(w->index);
+	free(w);
+}
+
+/*Returns an archive of a single chunk holding only the board*/
+unsigned char *archive_image(game_board *board, size_t *size){
+	unsigned char *image,*record;
+	chunk_info c;
+	size_t record_bytes=binary_record_size(board);
+	record=(unsigned char*)malloc(record_bytes);
+	image=(unsigned char*)malloc(ARCHIVE_HEADER_SIZE+lz_bound(record_bytes)+INDEX_ENTRY_SIZE);
+	if(record==NULL || image==NULL) function_error(f_malloc);
+	encode_board(board,record);
+	c.offset=ARCHIVE_HEADER_SIZE;
+	c.packed_size=lz_compress(record,record_bytes,image+ARCHIVE_HEADER_SIZE);
+	c.raw_size=record_bytes;
+	c.first=0;
+	c.count=1;
+	encode_chunk_info(image+ARCHIVE_HEADER_SIZE+c.packed_size,&c);
+	encode_archive_header(image,1,1,ARCHIVE_HEADER_SIZE+c.packed_size);
+	*size=ARCHIVE_HEADER_SIZE+c.packed_size+INDEX_ENTRY_SIZE;
+	free(record);
+	return image;
+}
+
+/*Reads size bytes at offset of the file, returns 0 if they can't all be read*/
+char read_at(int fd, unsigned char *buffer, size_t size, unsigned long offset){
+	ssize_t count;
+	while(size){
+		count=pread(fd,buffer,size,(off_t)offset);
+		if(count<=0)
+			return 0;
+		buffer+=count;
+		size-=count;
+		offset+=count;
+	}
+	return 1;
+}
+
+/*Reads the header and index of the archive open at fd, checking they fit in the file
+ * Returns the index (chunks entries, freed by the caller), or NULL if the file isn't a valid archive*/
+unsigned char *read_archive_index(int fd, unsigned long *boards, unsigned long *chunks, unsigned long *file_size){
+	struct stat st;
+	unsigned char header[ARCHIVE_HEADER_SIZE],*index;
+	unsigned long index_offset;
+	if(fstat(fd,&st) || !S_ISREG(st.st_mode) || !read_at(fd,header,ARCHIVE_HEADER_SIZE,0))
+		return NULL;
+	if(memcmp(header,ARCHIVE_MAGIC,4) || decode_number(header+4,4)!=ARCHIVE_VERSION)
+		return NULL;
+	*file_size=st.st_size;
+	*boards=decode_number(header+8,4);
+	*chunks=decode_number(header+12,4);
+	index_offset=decode_number(header+16,8);
+	if(index_offset>*file_size || (*file_size-index_offset)/INDEX_ENTRY_SIZE<*chunks)
+		return NULL;
+	index=(unsigned char*)malloc(*chunks*INDEX_ENTRY_SIZE+1);
+	if(index==NULL) function_error(f_malloc);
+	if(!read_at(fd,index,*chunks*INDEX_ENTRY_SIZE,index_offset)){
+		free(index);
+		return NULL;
+	}
+	return index;
+}
+
+/*Reads and decompresses a chunk into *raw, growing the buffers as needed
+ * Returns 0 if the chunk doesn't fit in the file or doesn't decompress*/
+char read_chunk(int fd, unsigned long file_size, chunk_info *c, unsigned char **packed, size_t *packed_capacity,
+		unsigned char **raw, size_t *raw_capacity){
+	if(c->offset>file_size || c->packed_size>file_size-c->offset || c->raw_size/MAX_RATIO>c->packed_size)
+		return 0;
+	reserve(packed,packed_capacity,c->packed_size+1);
+	reserve(raw,raw_capacity,c->raw_size+1);
+	return read_at(fd,*packed,c->packed_size,c->offset) && lz_decompress(*packed,c->packed_size,*raw,c->raw_size);
+}
+
+/*Decodes the record at *position of the records of a chunk and moves *position past it
+ * Returns a 0x0 board if the record doesn't fit in the chunk or has a value out of range*/
+game_board next_record(unsigned char *raw, size_t raw_size, size_t *position){
+	game_board board;
+	size_t size;
+	board.block_rows=0;
+	board.block_columns=0;
+	if(raw_size-*position<2 || !raw[*position] || !raw[*position+1])
+		return board;
+	size=record_size(raw[*position],raw[*position+1]);
+	if(size>raw_size-*position)
+		return board;
+	board=decode_board(raw+*position);
+	*position+=size;
+	return board;
+}
+
+/*Loads board number index of the archive at path
+ * The index is searched for the chunk of the board, and only that chunk is read and decompressed*/
+game_board load_archive_board(char *path, long index){
+	int fd;
+	unsigned char *entries,*packed=NULL,*raw=NULL;
+	size_t packed_capacity=0,raw_capacity=0,position=0;
+	unsigned long boards,chunks,file_size,low,high,mid;
+	chunk_info c;
+	game_board board;
+	board.block_rows=0;
+	board.block_columns=0;
+	fd=open(path,O_RDONLY);
+	if(fd<0)
+		return board;
+	entries=read_archive_index(fd,&boards,&chunks,&file_size);
+	if(entries!=NULL && index>=0 && (unsigned long)index<boards && chunks){
+		for(low=0,high=chunks-1;low<high;){ /*The last chunk whose first board isn't after index*/
+			mid=(low+high+1)/2;
+			decode_chunk_info(entries+mid*INDEX_ENTRY_SIZE,&c);
+			if(c.first<=(unsigned long)index)
+				low=mid;
+			else
+				high=mid-1;
+		}
+		decode_chunk_info(entries+low*INDEX_ENTRY_SIZE,&c);
+		if(c.first<=(unsigned long)index && (unsigned long)index-c.first<c.count
+				&& read_chunk(fd,file_size,&c,&packed,&packed_capacity,&raw,&raw_capacity)){
+			board=next_record(raw,c.raw_size,&position);
+			while(board.block_rows && c.first<(unsigned long)index){
+				free_board(&board);
+				board=next_record(raw,c.raw_size,&position);
+				c.first++;
+			}
+		}
+	}
+	close(fd);
+	free(entries);
+	free(packed);
+	free(raw);
+	return board;
+}
+
+/*The body of a worker thread of a reader: decompresses the chunks in order, staying at most
+ * window chunks ahead of the reader*/
+void *run_chunk_worker(void *arg){
+	archive_reader *r=(archive_reader*)arg;
+	chunk_slot *slot;
+	chunk_info c;
+	unsigned long number;
+	char ok;
+	pthread_mutex_lock(&r->lock);
+	while(1){
+		while(!r->stop && r->claimed<r->chunks && r->claimed-r->current>=(unsigned long)r->window)
+			pthread_cond_wait(&r->slot_freed,&r->lock);
+		if(r->stop || r->claimed==r->chunks)
+			break;
+		number=r->claimed++;
+		slot=&r->slots[number%r->window];
+		slot->state=chunk_busy;
+		pthread_mutex_unlock(&r->lock);
+		decode_chunk_info(r->index+number*INDEX_ENTRY_SIZE,&c);
+		ok=read_chunk(r->fd,r->size,&c,&slot->packed,&slot->packed_capacity,&slot->raw,&slot->raw_capacity);
+		slot->raw_size=c.raw_size;
+		pthread_mutex_lock(&r->lock);
+		slot->state=ok?chunk_ready:chunk_damaged;
+		pthread_cond_broadcast(&r->chunk_done);
+	}
+	pthread_mutex_unlock(&r->lock);
+	return NULL;
+}
+
+/*Opens the archive at path and starts the worker threads*/
+archive_reader *open_archive_reader(char *path, int threads){
+	archive_reader *r;
+	unsigned long boards;
+	int i;
+	r=(archive_reader*)calloc(1,sizeof(archive_reader));
+	if(r==NULL) function_error(f_calloc);
+	r->fd=open(path,O_RDONLY);
+	if(r->fd>=0)
+		r->index=read_archive_index(r->fd,&boards,&r->chunks,&r->size);
+	if(r->index==NULL){
+		if(r->fd>=0)
+			close(r->fd);
+		free(r);
+		return NULL;
+	}
+	r->worker_count=threads>0?threads:1;
+	r->window=r->worker_count*CHUNKS_PER_THREAD;
+	r->slots=(chunk_slot*)calloc(r->window,sizeof(chunk_slot));
+	r->workers=(pthread_t*)malloc(sizeof(pthread_t)*r->worker_count);
+	if(r->slots==NULL || r->workers==NULL) function_error(f_calloc);
+	pthread_mutex_init(&r->lock,NULL);
+	pthread_cond_init(&r->chunk_done,NULL);
+	pthread_cond_init(&r->slot_freed,NULL);
+	for(i=0;i<r->worker_count;i++){
+		if(pthread_create(&r->workers[i],NULL,run_chunk_worker,r)) function_error(f_thread);
+	}
+	return r;
+}
+
+/*Puts the next board of the archive in *board
+ * Once the records of a chunk are used up its slot is handed back to the workers*/
+int next_archive_board(archive_reader *r, game_board *board){
+	chunk_slot *slot;
+	chunk_state state;
+	while(1){
+		if(r->current==r->chunks)
+			return 0;
+		slot=&r->slots[r->current%r->window];
+		pthread_mutex_lock(&r->lock);
+		if(!r->started){
+			while(r->claimed<=r->current || slot->state==chunk_busy)
+				pthread_cond_wait(&r->chunk_done,&r->lock);
+			r->started=1;
+			r->position=0;
+		}
+		state=slot->state;
+		pthread_mutex_unlock(&r->lock);
+		if(state==chunk_damaged)
+			return -1;
+		if(r->position<slot->raw_size){
+			*board=next_record(slot->raw,slot->raw_size,&r->position);
+			return board->block_rows?1:-1;
+		}
+		pthread_mutex_lock(&r->lock);
+		slot->state=chunk_free;
+		r->current++;
+		r->started=0;
+		pthread_cond_broadcast(&r->slot_freed);
+		pthread_mutex_unlock(&r->lock);
+	}
+}
+
+/*Stops the worker threads and frees the reader*/
+void close_archive_reader(archive_reader *r){
+	int i;
+	pthread_mutex_lock(&r->lock);
+	r->stop=1;
+	pthread_cond_broadcast(&r->slot_freed);
+	pthread_mutex_unlock(&r->lock);
+	for(i=0;i<r->worker_count;i++)
+		pthread_join(r->workers[i],NULL);
+	for(i=0;i<r->window;i++){
+		free(r->slots[i].raw);
+		free(r->slots[i].packed);
+	}
+	pthread_mutex_destroy(&r->lock);
+	pthread_cond_destroy(&r->chunk_done);
+	pthread_cond_destroy(&r->slot_freed);
+	close(r->fd);
+	free(r->slots);
+	free(r->workers);
+	free(r->index);
+	free(r);
+}
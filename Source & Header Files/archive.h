@@ -0,0 +1,54 @@
+/*This module handles compressed archives of boards: the records of the binary format (see binary_format.h)
+ * are grouped into chunks of about CHUNK_SIZE bytes, and every chunk is compressed on its own (see lz_codec.h),
+ * so an archive is written and read a chunk at a time and a board is found without reading the chunks before it
+ *
+ * header:  "SDKZ", version, board count, chunk count (32 bit each), index offset (64 bit)
+ * chunks:  the compressed records
+ * index:   for every chunk its offset (64 bit), compressed size, size of its records, number of its
+ *          first board and number of boards (32 bit each)
+ * All the numbers are little endian*/
+
+#ifndef _ARCHIVEH_
+#define _ARCHIVEH_
+
+#include <stdio.h>
+#include <stddef.h>
+#include "board.h"
+
+#define ARCHIVE_EXTENSION ".sdz"
+
+typedef struct archive_writer archive_writer;
+typedef struct archive_reader archive_reader;
+
+/*Returns 1 if the path names a compressed archive, i.e. it has the archive extension*/
+char is_archive_path(char *path);
+
+/*Starts an archive in file, which is open for writing and empty*/
+archive_writer *create_archive_writer(FILE *file);
+
+/*Adds the board to the archive, returns 0 if the binary format can't store it*/
+char archive_add(archive_writer *w, game_board *board);
+
+/*Writes the last chunk, the index and the header, and frees the writer (the file is left open)*/
+void finish_archive(archive_writer *w);
+
+/*Returns an archive holding only the board, its size is put in *size
+ * Assumes the blocks of the board aren't too large for the binary format*/
+unsigned char *archive_image(game_board *board, size_t *size);
+
+/*Loads board number index (counting from 0) of the archive at path, only its chunk is read
+ * Returns a 0x0 board if the file can't be read, isn't a valid archive or has no such board*/
+game_board load_archive_board(char *path, long index);
+
+/*Opens the archive at path for reading its boards in order, threads worker threads decompress
+ * the chunks ahead of the reader. Returns NULL if the file can't be read or isn't a valid archive*/
+archive_reader *open_archive_reader(char *path, int threads);
+
+/*Puts the next board of the archive in *board, which the caller frees
+ * Returns 1 on success, 0 at the end of the archive, -1 if the archive is damaged*/
+int next_archive_board(archive_reader *r, game_board *board);
+
+/*Stops the worker threads and frees the reader*/
+void close_archive_reader(archive_reader *r);
+
+#endif
@@ -0,0 +1,467 @@
+/*This module finds the cells the autofill command fills*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "board.h"
+#include "stack_tools.h"
+#include "error_handler.h"
+#include "autofill.h"
+
+/*Returns a 2d array that represent the values to be autofilled
+ * Such that, for every arr[3] in the stack, it holds that:
+ * arr[0]=x coordinate
+ * arr[1]=y coordinate
+ * arr[2]=value to fill
+ * NULL pointer indicates the end of the list*/
+int **get_autofill_cells(game_board *board)
+{
+	Stack stk;
+	int *arr;
+	int *valid_values;
+	int x,y,amount,i;
+	int **res;
+
+	x=board_len(board)-1;
+	y=board_len(board)-1;
+	stk=create_stack();
+	/*The cells are inserted into the stack in reverse order so they're popped
+	 * out in the right order*/
+	while(y>=0)
+	{
+		if(!board->cells[x][y].is_fixed && board->cells[x][y].value == 0){
+			valid_values=get_valid_values(board,x,y);
+			if(valid_values[0] && !valid_values[1])
+			{
+				arr=(int*)malloc(sizeof(int)*3);
+				if(arr==NULL)
+					function_error(f_malloc);
+				arr[0]=x;
+				arr[1]=y;
+				arr[2]=valid_values[0];
+				push(&stk,arr);
+			}
+			free(valid_values);
+		}
+		/*Advancing to the next cell*/
+		if(x==0){
+			x=board_len(board)-1;
+			y--;
+		}
+		else{
+			x--;
+		}
+	}
+
+	amount=stk.size;
+	if(!amount)
+		return NULL;
+	res=(int**)malloc(sizeof(int*)*(amount+1));
+	if(res==NULL)function_error(f_malloc);
+
+	for(i=0;i<amount;i++)
+		res[i]=(int*)pop(&stk);
+	res[amount]=NULL; /*Indicates the end of list*/
+
+	return res;
+}
+
+/*Frees a 2d array returned by one of the functions of this module*/
+void free_fills(int **fills){
+	int **p;
+	if(fills==NULL)
+		return;
+	for(p=fills;*p!=NULL;p++)
+		free(*p);
+	free(fills);
+}
+
+/*Returns the number of valid values of the cell <x,y> and puts the last of them in *value
+ * Reads the values_in_x arrays directly instead of allocating an array like get_valid_values*/
+int count_valid_values(game_board *board, int x, int y, int *value){
+	int i,cnt,block_index;
+	block_index=get_block_index(board,x,y);
+	cnt=0;
+	for(i=1;i<=board_len(board);i++){
+		if(!board->values_in_block[block_index][i] &&
+			!board->values_in_column[x][i] &&
+			!board->values_in_row[y][i]){
+			cnt++;
+			*value=i;
+		}
+	}
+	return cnt;
+}
+
+/*A queue of the cells that should be checked again, cells are kept as y*len+x
+ * Every cell is in the queue at most once, which bounds its size by the number of cells*/
+typedef struct cell_queue{
+	int *cells;
+	char *queued; /*queued[i] is 1 if cell i is currently in the queue*/
+	int head,count,capacity;
+} cell_queue;
+
+/*The cells filled so far, in the format of get_autofill_cells*/
+typedef struct fill_list{
+	int **cells;
+	int count,capacity;
+} fill_list;
+
+/*The valid values that are left for every cell of the board, as bitsets
+ * Bit v of a cell's set is on if v can still be placed in it. Unlike the values_in_x
+ * arrays these also keep the values ruled out by deductions that don't fill a cell*/
+typedef struct candidates{
+	unsigned long *bits; /*The set of cell <x,y> is the words starting at (y*len+x)*words*/
+	int words; /*Words per set, enough for the bits 0..len*/
+} candidates;
+
+#define WORD_BITS (CHAR_BIT*sizeof(unsigned long))
+#define HAS_VALUE(set,v) (((set)[(v)/WORD_BITS]>>((v)%WORD_BITS))&1UL)
+#define CLEAR_VALUE(set,v) ((set)[(v)/WORD_BITS]&=~(1UL<<((v)%WORD_BITS)))
+#define ADD_VALUE(set,v) ((set)[(v)/WORD_BITS]|=1UL<<((v)%WORD_BITS))
+
+/*Initializes an empty queue with room for every cell of the board*/
+void init_queue(cell_queue *q, game_board *board){
+	q->capacity=board_len(board)*board_len(board);
+	q->head=0;
+	q->count=0;
+	q->cells=(int*)malloc(sizeof(int)*q->capacity);
+	if(q->cells==NULL) function_error(f_malloc);
+	q->queued=(char*)calloc(q->capacity,sizeof(char));
+	if(q->queued==NULL) function_error(f_calloc);
+}
+
+/*Adds the cell <x,y> to the end of the queue if it is empty and not already there*/
+void enqueue_cell(cell_queue *q, game_board *board, int x, int y){
+	int cell;
+	cell=y*board_len(board)+x;
+	if(q->queued[cell] || board->cells[x][y].value)
+		return;
+	q->queued[cell]=1;
+	q->cells[(q->head+q->count)%q->capacity]=cell;
+	q->count++;
+}
+
+/*Removes the first cell of the queue and returns it, assumes the queue isn't empty*/
+int dequeue_cell(cell_queue *q){
+	int cell;
+	cell=q->cells[q->head];
+	q->head=(q->head+1)%q->capacity;
+	q->count--;
+	q->queued[cell]=0;
+	return cell;
+}
+
+/*Adds all the cells that share a row, column or block with <x,y> to the queue*/
+void enqueue_peers(cell_queue *q, game_board *board, int x, int y){
+	int i,peer_x,peer_y,block_index;
+	block_index=get_block_index(board,x,y);
+	for(i=0;i<board_len(board);i++){
+		enqueue_cell(q,board,i,y);
+		enqueue_cell(q,board,x,i);
+		get_cell_in_block(board,block_index,i,&peer_x,&peer_y);
+		enqueue_cell(q,board,peer_x,peer_y);
+	}
+}
+
+/*Sets <x,y> to value and appends it to the list*/
+void fill_cell(fill_list *fills, game_board *board, int x, int y, int value){
+	int *arr;
+	set_cell(board,x,y,value);
+	arr=(int*)malloc(sizeof(int)*3);
+	if(arr==NULL) function_error(f_malloc);
+	arr[0]=x;
+	arr[1]=y;
+	arr[2]=value;
+	if(fills->count+1>=fills->capacity){ /*Keeping room for the NULL at the end*/
+		fills->capacity=fills->capacity?fills->capacity*2:board_len(board)+1;
+		fills->cells=(int**)realloc(fills->cells,sizeof(int*)*fills->capacity);
+		if(fills->cells==NULL) function_error(f_malloc);
+	}
+	fills->cells[fills->count++]=arr;
+}
+
+/*Returns the list in the format of get_autofill_cells, NULL if nothing was filled*/
+int **finish_fills(fill_list *fills){
+	if(!fills->count){
+		free(fills->cells);
+		return NULL;
+	}
+	fills->cells[fills->count]=NULL;
+	return fills->cells;
+}
+
+/*Fills cells that have a single valid value until there are none left
+ * Only the peers of a filled cell can lose valid values, so after a single scan
+ * of the board only those are checked again, through a queue
+ * Returns the filled cells in the format of get_autofill_cells, in the order they were filled*/
+int **autofill_to_fixpoint(game_board *board){
+	cell_queue q;
+	fill_list fills={NULL,0,0};
+	int x,y,cell,value,len;
+	len=board_len(board);
+	init_queue(&q,board);
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++){
+			if(!board->cells[x][y].is_fixed)
+				enqueue_cell(&q,board,x,y);
+		}
+	}
+	while(q.count){
+		cell=dequeue_cell(&q);
+		x=cell%len;
+		y=cell/len;
+		if(board->cells[x][y].value || count_valid_values(board,x,y,&value)!=1)
+			continue;
+		fill_cell(&fills,board,x,y,value);
+		enqueue_peers(&q,board,x,y);
+	}
+	free(q.cells);
+	free(q.queued);
+	return finish_fills(&fills);
+}
+
+/*Returns the set of the cell <x,y>*/
+unsigned long *cell_set(candidates *cand, game_board *board, int x, int y){
+	return cand->bits+(y*board_len(board)+x)*cand->words;
+}
+
+/*Builds the candidate sets of all the cells from the values_in_x arrays
+ * Filled cells have an empty set*/
+void init_candidates(candidates *cand, game_board *board){
+	int x,y,len,value;
+	unsigned long *set;
+	len=board_len(board);
+	cand->words=len/WORD_BITS+1;
+	cand->bits=(unsigned long*)calloc(len*len*cand->words,sizeof(unsigned long));
+	if(cand->bits==NULL) function_error(f_calloc);
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++){
+			if(board->cells[x][y].value)
+				continue;
+			set=cell_set(cand,board,x,y);
+			for(value=1;value<=len;value++){
+				if(!board->values_in_block[get_block_index(board,x,y)][value] &&
+					!board->values_in_column[x][value] &&
+					!board->values_in_row[y][value])
+					ADD_VALUE(set,value);
+			}
+		}
+	}
+}
+
+/*Returns the number of values in the set and puts the last of them in *value*/
+int count_set(unsigned long *set, int len, int *value){
+	int v,cnt=0;
+	for(v=1;v<=len;v++){
+		if(HAS_VALUE(set,v)){
+			cnt++;
+			*value=v;
+		}
+	}
+	return cnt;
+}
+
+/*Rules value out of the cell <x,y>, queueing it if that changed its set
+ * Returns 1 if the set was changed*/
+char eliminate(candidates *cand, cell_queue *q, game_board *board, int x, int y, int value){
+	unsigned long *set;
+	set=cell_set(cand,board,x,y);
+	if(board->cells[x][y].value || !HAS_VALUE(set,value))
+		return 0;
+	CLEAR_VALUE(set,value);
+	enqueue_cell(q,board,x,y);
+	return 1;
+}
+
+/*Fills <x,y> with value and rules value out of all of its peers*/
+void deduce_fill(candidates *cand, cell_queue *q, fill_list *fills, game_board *board, int x, int y, int value){
+	int i,peer_x,peer_y,block_index,w;
+	unsigned long *set;
+	fill_cell(fills,board,x,y,value);
+	set=cell_set(cand,board,x,y);
+	for(w=0;w<cand->words;w++)
+		set[w]=0;
+	block_index=get_block_index(board,x,y);
+	for(i=0;i<board_len(board);i++){
+		eliminate(cand,q,board,i,y,value);
+		eliminate(cand,q,board,x,i,value);
+		get_cell_in_block(board,block_index,i,&peer_x,&peer_y);
+		eliminate(cand,q,board,peer_x,peer_y,value);
+	}
+}
+
+/*Puts the coordinates of the i'th cell of unit u in (x,y)
+ * Units 0..len-1 are the rows, len..2*len-1 the columns and 2*len..3*len-1 the blocks*/
+void get_cell_in_unit(game_board *board, int u, int i, int *x, int *y){
+	int len;
+	len=board_len(board);
+	if(u<len){
+		*x=i;
+		*y=u;
+	}else if(u<2*len){
+		*x=u-len;
+		*y=i;
+	}else{
+		get_cell_in_block(board,u-2*len,i,x,y);
+	}
+}
+
+/*Accumulates set into once/twice, so that once holds the values seen at least once
+ * and twice the values seen at least twice*/
+void accumulate(unsigned long *once, unsigned long *twice, unsigned long *set, int words){
+	int w;
+	for(w=0;w<words;w++){
+		twice[w]|=once[w]&set[w];
+		once[w]|=set[w];
+	}
+}
+
+/*Fills every value that has a single possible cell in some unit (hidden singles)
+ * A unit is handled with one pass over its cells using the once/twice sets
+ * Returns 1 if any cell was filled*/
+char fill_hidden_singles(candidates *cand, cell_queue *q, fill_list *fills, game_board *board,
+		unsigned long *once, unsigned long *twice){
+	int u,i,w,v,x,y,len;
+	char changed=0;
+	len=board_len(board);
+	for(u=0;u<3*len;u++){
+		for(w=0;w<cand->words;w++){
+			once[w]=0;
+			twice[w]=0;
+		}
+		for(i=0;i<len;i++){
+			get_cell_in_unit(board,u,i,&x,&y);
+			accumulate(once,twice,cell_set(cand,board,x,y),cand->words);
+		}
+		for(v=1;v<=len;v++){
+			if(!HAS_VALUE(once,v) || HAS_VALUE(twice,v))
+				continue;
+			for(i=0;i<len;i++){ /*Finding the single cell of v, it may have been filled meanwhile*/
+				get_cell_in_unit(board,u,i,&x,&y);
+				if(HAS_VALUE(cell_set(cand,board,x,y),v)){
+					deduce_fill(cand,q,fills,board,x,y,v);
+					changed=1;
+					break;
+				}
+			}
+		}
+	}
+	return changed;
+}
+
+/*Handles one intersection of a block with a row or a column (segments of block_rows or
+ * block_columns cells): a value that, inside the unit whose segments are scanned, can only be
+ * in a single segment, is ruled out of the rest of the other unit that contains that segment
+ * Blocks split into row segments and column segments (pointing), rows and columns split into
+ * block segments (claiming). Returns 1 if any value was ruled out*/
+char eliminate_locked(candidates *cand, cell_queue *q, game_board *board, int u,
+		unsigned long *once, unsigned long *twice, unsigned long *seg){
+	int len,seg_len,seg_num,s,i,j,w,v,x,y,ox,oy,other,in_segment;
+	char changed=0;
+	len=board_len(board);
+	for(w=0;w<cand->words;w++){
+		once[w]=0;
+		twice[w]=0;
+	}
+	if(u<len){ /*A row, its segments are the blocks it crosses*/
+		seg_len=board->block_columns;
+	}else if(u<2*len){ /*A column*/
+		seg_len=board->block_rows;
+	}else if(u<3*len){ /*A block split into row segments*/
+		seg_len=board->block_columns;
+	}else{ /*The same block split into column segments*/
+		seg_len=board->block_rows;
+	}
+	seg_num=len/seg_len;
+	for(s=0;s<seg_num;s++){
+		for(w=0;w<cand->words;w++)
+			seg[w]=0;
+		for(j=0;j<seg_len;j++){
+			if(u<3*len){
+				get_cell_in_unit(board,u,s*seg_len+j,&x,&y);
+			}else{ /*Column s of the block*/
+				get_cell_in_block(board,u-3*len,j*board->block_columns+s,&x,&y);
+			}
+			for(w=0;w<cand->words;w++)
+				seg[w]|=cell_set(cand,board,x,y)[w];
+		}
+		accumulate(once,twice,seg,cand->words);
+	}
+	for(v=1;v<=len;v++){
+		if(!HAS_VALUE(once,v) || HAS_VALUE(twice,v))
+			continue;
+		/*v is locked in a single segment, finding one of its cells, then the other unit*/
+		for(i=0;i<len;i++){
+			if(u<3*len){
+				get_cell_in_unit(board,u,i,&x,&y);
+			}else{
+				get_cell_in_block(board,u-3*len,(i%board->block_rows)*board->block_columns+i/board->block_rows,&x,&y);
+			}
+			if(HAS_VALUE(cell_set(cand,board,x,y),v))
+				break;
+		}
+		if(u<2*len){
+			other=2*len+get_block_index(board,x,y);
+		}else if(u<3*len){
+			other=y;
+		}else{
+			other=len+x;
+		}
+		for(i=0;i<len;i++){
+			get_cell_in_unit(board,other,i,&ox,&oy);
+			if(u<len){
+				in_segment=(oy==y);
+			}else if(u<2*len){
+				in_segment=(ox==x);
+			}else{
+				in_segment=(get_block_index(board,ox,oy)==u%len);
+			}
+			if(!in_segment && eliminate(cand,q,board,ox,oy,v))
+				changed=1;
+		}
+	}
+	return changed;
+}
+
+/*Fills cells using naked singles, hidden singles and locked candidates until none of them applies
+ * Cells are only filled with values that are forced by the current board, so a board without
+ * errors never gets new errors, and the deductions can't fill a cell a solution wouldn't
+ * Returns the filled cells in the format of get_autofill_cells, in the order they were filled*/
+int **autofill_deduce(game_board *board){
+	cell_queue q;
+	fill_list fills={NULL,0,0};
+	candidates cand;
+	unsigned long *once,*twice,*seg;
+	int x,y,cell,value,len,u;
+	char changed=1;
+	len=board_len(board);
+	init_queue(&q,board);
+	init_candidates(&cand,board);
+	once=(unsigned long*)malloc(sizeof(unsigned long)*cand.words*3);
+	if(once==NULL) function_error(f_malloc);
+	twice=once+cand.words;
+	seg=twice+cand.words;
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++)
+			enqueue_cell(&q,board,x,y);
+	}
+	while(changed){
+		while(q.count){ /*Naked singles, the cheapest deduction, go first*/
+			cell=dequeue_cell(&q);
+			x=cell%len;
+			y=cell/len;
+			if(!board->cells[x][y].value && count_set(cell_set(&cand,board,x,y),len,&value)==1)
+				deduce_fill(&cand,&q,&fills,board,x,y,value);
+		}
+		changed=fill_hidden_singles(&cand,&q,&fills,board,once,twice);
+		for(u=0;u<4*len && !changed;u++) /*Units 3*len..4*len-1 are the blocks split into columns*/
+			changed=eliminate_locked(&cand,&q,board,u,once,twice,seg);
+		changed=changed || q.count;
+	}
+	free(once);
+	free(cand.bits);
+	free(q.cells);
+	free(q.queued);
+	return finish_fills(&fills);
+}
@@ -0,0 +1,25 @@
+/*This module finds the cells the autofill command fills*/
+
+#include "board.h"
+
+/*Autofill levels, kept in args[0] of an autofill command*/
+#define AUTOFILL_SINGLE_PASS 0 /*autofill - fills the cells that currently have a single valid value*/
+#define AUTOFILL_FIXPOINT 1 /*autofill all - keeps filling until no such cell is left*/
+#define AUTOFILL_DEDUCE 2 /*autofill deep - also fills hidden singles and uses locked candidates*/
+
+/*Returns a 2d array of the cells that currently have a single valid value,
+ * every element is an int[3] holding x, y and the value, NULL ends the list
+ * Returns NULL if there are no such cells*/
+int **get_autofill_cells(game_board *board);
+
+/*Frees a 2d array returned by one of the functions of this module*/
+void free_fills(int **fills);
+
+/*Fills cells that have a single valid value until there are none left, the filled cells
+ * are returned in the same format as get_autofill_cells, in the order they were filled*/
+int **autofill_to_fixpoint(game_board *board);
+
+/*Same as autofill_to_fixpoint, but also fills values that have a single possible cell in a row,
+ * column or block (hidden singles), and rules out values locked into the intersection of a block
+ * with a row or column (pointing/claiming) to find more of both*/
+int **autofill_deduce(game_board *board);
@@ -0,0 +1,452 @@
+/*This module handles the non-interactive modes of the program, which are selected
+ * by command line arguments (e.g. generating a large set of puzzles into a file)*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "board.h"
+#include "parser.h"
+#include "error_handler.h"
+#include "solver_context.h"
+#include "generator.h"
+#include "file_operations.h"
+#include "transform.h"
+#include "binary_format.h"
+#include "executer.h"
+#include "line_solver.h"
+#include "stress_test.h"
+#include "batch.h"
+
+#define GENERATE_ARGS 8 /*program name, -generate and its 6 arguments*/
+#define TRANSFORM_ARGS 5 /*program name, -transform and at least 3 arguments*/
+#define DEDUP_FACTOR 2 /*With -dedup the workers may generate this many times the puzzles asked for*/
+#define GENERATE_QUEUE_LEN 64 /*Puzzles between the workers and the writer, the workers wait while it is full*/
+
+/*A struct that keeps the parameters of a batch generation*/
+typedef struct generate_options{
+	int block_rows,block_columns;
+	int x,y; /*Same meaning as the arguments of the generate command*/
+	int count; /*Number of puzzles to generate*/
+	int jobs; /*Number of worker threads*/
+	char unique; /*Whether only puzzles with a single solution are accepted*/
+	char dedup; /*Whether puzzles that are transformations of one already written are dropped*/
+	char *path; /*Output file*/
+} generate_options;
+
+/*A struct that keeps the canonical forms of the boards seen so far, as records of the binary format
+ * in a hash table with open addressing*/
+typedef struct board_set{
+	unsigned char **records; /*NULL marks an empty slot*/
+	unsigned long capacity; /*A power of 2, kept at least twice the count*/
+	unsigned long count;
+} board_set;
+
+/*A struct that keeps what the worker threads and the writer of a batch generation share
+ * Worker i generates with contexts[i], the puzzles wait in queue[head], queue[head+1]... until they are written*/
+typedef struct generate_run{
+	generate_options *opt;
+	solver_context *contexts;
+	game_board *queue;
+	int head,queued;
+	int next_worker; /*Index of the next worker to start, taken under lock*/
+	int open_workers; /*Workers that haven't finished yet*/
+	char stop; /*Set by the writer once it needs no more puzzles*/
+	char failed; /*Set by a worker whose generation failed*/
+	pthread_mutex_t lock;
+	pthread_cond_t slot_freed,puzzle_ready;
+} generate_run;
+
+/*Prints the command line usage of the batch modes*/
+void print_usage(char *program){
+	printf("Usage: %s -generate <block_rows> <block_columns> <X> <Y> <N> <output> [-unique] [-dedup] [-jobs <J>]\n",program);
+	printf("       %s -transform <N> <output> <template>...\n",program);
+	printf("       %s -solve-lines <input> <output> [-jobs <J>]\n",program);
+	printf("       %s -solve-archive <input> <output> [-jobs <J>]\n",program);
+	printf("       %s -stress <N> [-jobs <J>]\n",program);
+	printf("       %s -script [<file>]\n",program);
+}
+
+/*Returns the number of seconds that passed since start*/
+double elapsed_seconds(struct timespec *start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (now.tv_sec-start->tv_sec)+(now.tv_nsec-start->tv_nsec)/1e9;
+}
+
+/*Fills opt according to the command line arguments of the -generate mode
+ * Returns 1 if the arguments are valid, otherwise prints an error and returns 0*/
+char parse_generate_options(int argc, char *argv[], generate_options *opt){
+	int i,cells;
+	if(argc<GENERATE_ARGS){
+		print_usage(argv[0]);
+		return 0;
+	}
+	opt->block_rows=string_to_int(argv[2]);
+	opt->block_columns=string_to_int(argv[3]);
+	opt->x=string_to_int(argv[4]);
+	opt->y=string_to_int(argv[5]);
+	opt->count=string_to_int(argv[6]);
+	opt->path=argv[7];
+	opt->unique=0;
+	opt->dedup=0;
+	opt->jobs=(int)sysconf(_SC_NPROCESSORS_ONLN);
+	for(i=GENERATE_ARGS;i<argc;i++){
+		if(!strcmp(argv[i],"-unique")){
+			opt->unique=1;
+		}else if(!strcmp(argv[i],"-dedup")){
+			opt->dedup=1;
+		}else if(!strcmp(argv[i],"-jobs") && i+1<argc){
+			opt->jobs=string_to_int(argv[++i]);
+		}else{
+			print_usage(argv[0]);
+			return 0;
+		}
+	}
+	if(opt->block_rows<=0 || opt->block_columns<=0 || opt->count<0 || opt->jobs<=0){
+		printf("Error: invalid batch arguments\n");
+		return 0;
+	}
+	cells=opt->block_rows*opt->block_columns*opt->block_rows*opt->block_columns;
+	if(opt->x<0 || opt->x>cells || opt->y<0 || opt->y>cells){
+		printf("Error: value not in range 0-%d\n",cells);
+		return 0;
+	}
+	if(opt->jobs>opt->count)
+		opt->jobs=opt->count?opt->count:1;
+	return 1;
+}
+
+/*The body of a worker thread: generates its share of the puzzles and queues each one for the writer
+ * Stops after the first failed generation, or once the writer needs no more puzzles*/
+void *run_generator_worker(void *arg){
+	generate_run *run=(generate_run*)arg;
+	generate_options *opt=run->opt;
+	solver_context *ctx;
+	game_board board;
+	int i,count;
+	pthread_mutex_lock(&run->lock);
+	i=run->next_worker++;
+	pthread_mutex_unlock(&run->lock);
+	ctx=&run->contexts[i];
+	/*Splitting the puzzles as evenly as possible between the workers*/
+	count=(opt->count/opt->jobs+(i<opt->count%opt->jobs))*(opt->dedup?DEDUP_FACTOR:1);
+	for(i=0;i<count;i++){
+		board=create_board(opt->block_rows,opt->block_columns);
+		if(!generate_puzzle(ctx,&board,opt->x,opt->y,opt->unique)){
+			free_board(&board);
+			pthread_mutex_lock(&run->lock);
+			if(!run->stop) /*Otherwise the generation was cancelled by the writer*/
+				run->failed=1;
+			pthread_mutex_unlock(&run->lock);
+			break;
+		}
+		pthread_mutex_lock(&run->lock);
+		while(run->queued==GENERATE_QUEUE_LEN && !run->stop)
+			pthread_cond_wait(&run->slot_freed,&run->lock);
+		if(run->stop){
+			pthread_mutex_unlock(&run->lock);
+			free_board(&board);
+			break;
+		}
+		run->queue[(run->head+run->queued)%GENERATE_QUEUE_LEN]=board;
+		run->queued++;
+		pthread_cond_signal(&run->puzzle_ready);
+		pthread_mutex_unlock(&run->lock);
+	}
+	pthread_mutex_lock(&run->lock);
+	run->open_workers--;
+	pthread_cond_signal(&run->puzzle_ready);
+	pthread_mutex_unlock(&run->lock);
+	return NULL;
+}
+
+/*Creates an empty set of boards*/
+board_set create_board_set(void){
+	board_set set;
+	set.capacity=64;
+	set.count=0;
+	set.records=(unsigned char**)calloc(set.capacity,sizeof(unsigned char*));
+	if(set.records==NULL) function_error(f_calloc);
+	return set;
+}
+
+/*Puts a record in the first empty slot of its probe sequence, the set has room for it*/
+void insert_record(board_set *set, unsigned char *record, size_t size){
+	unsigned long i=record_hash(record,size)&(set->capacity-1);
+	while(set->records[i]!=NULL)
+		i=(i+1)&(set->capacity-1);
+	set->records[i]=record;
+}
+
+/*Adds the canonical form of the board to the set, returns 0 if it was there already
+ * All the boards of a set have the same dimensions, so their records have the same size*/
+char add_unseen_board(board_set *set, game_board *board){
+	game_board canonical;
+	board_transform back;
+	unsigned char *record,**old;
+	unsigned long i,old_capacity;
+	size_t size=binary_record_size(board);
+	record=(unsigned char*)malloc(size);
+	if(record==NULL) function_error(f_malloc);
+	canonical=create_board(board->block_rows,board->block_columns);
+	back=create_transform(board->block_rows,board->block_columns);
+	canonical_form(board,&canonical,&back);
+	encode_board(&canonical,record);
+	free_board(&canonical);
+	free_transform(&back);
+	for(i=record_hash(record,size)&(set->capacity-1);set->records[i]!=NULL;i=(i+1)&(set->capacity-1)){
+		if(!memcmp(set->records[i],record,size)){
+			free(record);
+			return 0;
+		}
+	}
+	if(2*(set->count+1)>set->capacity){ /*Growing keeps the probe sequences short*/
+		old=set->records;
+		old_capacity=set->capacity;
+		set->capacity*=2;
+		set->records=(unsigned char**)calloc(set->capacity,sizeof(unsigned char*));
+		if(set->records==NULL) function_error(f_calloc);
+		for(i=0;i<old_capacity;i++){
+			if(old[i]!=NULL)
+				insert_record(set,old[i],size);
+		}
+		free(old);
+	}
+	insert_record(set,record,size);
+	set->count++;
+	return 1;
+}
+
+/*Frees the records of the set*/
+void free_board_set(board_set *set){
+	unsigned long i;
+	for(i=0;i<set->capacity;i++)
+		free(set->records[i]);
+	free(set->records);
+}
+
+/*Writes the queued puzzles to the output file until enough were written or no worker is left
+ * With -dedup it drops the puzzles whose canonical form was written already
+ * Then it stops the workers, cancelling the puzzles they are still generating*/
+void write_puzzles(generate_run *run, board_writer *out, int *written, int *dropped){
+	generate_options *opt=run->opt;
+	game_board board;
+	board_set seen;
+	int i;
+	seen=create_board_set();
+	pthread_mutex_lock(&run->lock);
+	while(*written<opt->count){
+		while(!run->queued && run->open_workers && !run->failed)
+			pthread_cond_wait(&run->puzzle_ready,&run->lock);
+		if(!run->queued || run->failed)
+			break;
+		board=run->queue[run->head];
+		run->head=(run->head+1)%GENERATE_QUEUE_LEN;
+		run->queued--;
+		pthread_cond_signal(&run->slot_freed);
+		pthread_mutex_unlock(&run->lock);
+		if(opt->dedup && !add_unseen_board(&seen,&board))
+			(*dropped)++;
+		else
+			*written+=add_board(out,&board);
+		free_board(&board);
+		pthread_mutex_lock(&run->lock);
+	}
+	run->stop=1;
+	for(i=0;i<opt->jobs;i++)
+		run->contexts[i].cancelled=1;
+	pthread_cond_broadcast(&run->slot_freed);
+	pthread_mutex_unlock(&run->lock);
+	free_board_set(&seen);
+}
+
+/*Generates the puzzles on the worker threads, every one with a context of its own, and writes them to
+ * the output file. The calling thread is the only writer, so the output is never interleaved
+ * Returns the exit status of the program*/
+int batch_generate(generate_options *opt){
+	generate_run run;
+	board_writer *out;
+	pthread_t *workers;
+	struct timespec start;
+	unsigned long seed;
+	int i,written=0,dropped=0;
+
+	out=open_board_writer(opt->path);
+	if(out==NULL){
+		printf("Error: File cannot be created or modified\n");
+		return 1;
+	}
+	run.opt=opt;
+	run.contexts=(solver_context*)malloc(sizeof(solver_context)*opt->jobs);
+	run.queue=(game_board*)malloc(sizeof(game_board)*GENERATE_QUEUE_LEN);
+	workers=(pthread_t*)malloc(sizeof(pthread_t)*opt->jobs);
+	if(run.contexts==NULL || run.queue==NULL || workers==NULL) function_error(f_malloc);
+	seed=(unsigned long)time(NULL);
+	for(i=0;i<opt->jobs;i++)
+		run.contexts[i]=create_context(seed+i); /*Every worker needs its own sequence of puzzles*/
+	run.head=run.queued=0;
+	run.next_worker=0;
+	run.open_workers=opt->jobs;
+	run.stop=run.failed=0;
+	pthread_mutex_init(&run.lock,NULL);
+	pthread_cond_init(&run.slot_freed,NULL);
+	pthread_cond_init(&run.puzzle_ready,NULL);
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	for(i=0;i<opt->jobs;i++){
+		if(pthread_create(&workers[i],NULL,run_generator_worker,&run)) function_error(f_thread);
+	}
+	write_puzzles(&run,out,&written,&dropped);
+	for(i=0;i<opt->jobs;i++)
+		pthread_join(workers[i],NULL);
+	close_board_writer(out);
+
+	if(!run.failed && dropped && written<opt->count)
+		printf("Error: not enough distinct puzzles were generated\n");
+	else if(run.failed || written<opt->count)
+		printf("Error: puzzle generator failed\n");
+	if(opt->dedup)
+		printf("Dropped %d duplicate puzzles\n",dropped);
+	printf("Generated %d puzzles in %.2f seconds (%.1f puzzles/sec)\n",
+			written,elapsed_seconds(&start),written/(elapsed_seconds(&start)+1e-9));
+	for(;run.queued;run.queued--,run.head=(run.head+1)%GENERATE_QUEUE_LEN)
+		free_board(&run.queue[run.head]); /*Puzzles that were generated after enough were written*/
+	for(i=0;i<opt->jobs;i++)
+		free_context(&run.contexts[i]);
+	pthread_mutex_destroy(&run.lock);
+	pthread_cond_destroy(&run.slot_freed);
+	pthread_cond_destroy(&run.puzzle_ready);
+	free(run.contexts);
+	free(run.queue);
+	free(workers);
+	return written<opt->count;
+}
+
+/*Loads the template boards given as the command line arguments from index first on
+ * Returns the number of loaded templates, or 0 if one of them can't be used*/
+int load_templates(int argc, char *argv[], int first, game_board *templates){
+	int i,count;
+	for(count=0,i=first;i<argc;i++,count++){
+		templates[count]=load_board(argv[i]);
+		if(templates[count].block_rows==0){
+			printf("Error: File doesn't exist or cannot be opened\n");
+			break;
+		}
+		if(templates[count].block_rows!=templates[0].block_rows || templates[count].block_columns!=templates[0].block_columns){
+			printf("Error: all templates must have the same dimensions\n");
+			free_board(&templates[count]);
+			break;
+		}
+	}
+	if(i==argc)
+		return count;
+	while(count)
+		free_board(&templates[--count]);
+	return 0;
+}
+
+/*Writes N random transformations of the template boards to the output file
+ * Every output board is a random template under a random validity preserving transformation,
+ * so the fixed cells of a template puzzle are transformed along with its values
+ * Returns the exit status of the program*/
+int batch_transform(int argc, char *argv[]){
+	board_writer *out;
+	game_board *templates,target;
+	board_transform t;
+	solver_context ctx;
+	struct timespec start;
+	int i,count,template_count,status;
+	if(argc<TRANSFORM_ARGS || (count=string_to_int(argv[2]))<0){
+		print_usage(argv[0]);
+		return 1;
+	}
+	templates=(game_board*)calloc(argc,sizeof(game_board));
+	if(templates==NULL) function_error(f_calloc);
+	template_count=load_templates(argc,argv,4,templates);
+	if(!template_count){
+		free(templates);
+		return 1;
+	}
+	out=open_board_writer(argv[3]);
+	if(out==NULL){
+		printf("Error: File cannot be created or modified\n");
+		for(i=0;i<template_count;i++)
+			free_board(&templates[i]);
+		free(templates);
+		return 1;
+	}
+	ctx=create_context(time(NULL));
+	t=create_transform(templates[0].block_rows,templates[0].block_columns);
+	target=create_board(templates[0].block_rows,templates[0].block_columns);
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	for(i=0;i<count;i++){
+		random_transform(&ctx,&t);
+		apply_transform(&t,&templates[random_below(&ctx,template_count)],&target);
+		if(!add_board(out,&target)){
+			printf("Error: the boards are too large for the binary format\n");
+			break;
+		}
+	}
+	close_board_writer(out);
+	printf("Generated %d boards in %.2f seconds (%.1f boards/sec)\n",
+			i,elapsed_seconds(&start),i/(elapsed_seconds(&start)+1e-9));
+	status=(i<count);
+	free_transform(&t);
+	free_context(&ctx);
+	free_board(&target);
+	for(i=0;i<template_count;i++)
+		free_board(&templates[i]);
+	free(templates);
+	return status;
+}
+
+/*Runs the commands read from in without prompts, the board is printed only by print_board
+ * Reports the number of commands and the time they took when in ends or an exit command is read*/
+int run_script(game_data *game, FILE *in){
+	struct timespec start;
+	commandInfo com;
+	char line[LINE_BUFFER_LEN];
+	int count=0;
+	double seconds;
+	game->quiet=1;
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	readCommand(in,line,&com);
+	while(com.commandName!=ex){
+		execute(game,&com);
+		count++;
+		readCommand(in,line,&com);
+	}
+	seconds=elapsed_seconds(&start);
+	printf("Executed %d commands in %.2f seconds (%.1f commands/sec)\n",count,seconds,count/(seconds+1e-9));
+	execute(game,&com); /*Exits the program*/
+	return 0;
+}
+
+/*Runs the mode selected by the command line arguments and returns the exit status of the program*/
+int run_batch(int argc, char *argv[]){
+	generate_options opt;
+	if(!strcmp(argv[1],"-generate")){
+		if(!parse_generate_options(argc,argv,&opt))
+			return 1;
+		return batch_generate(&opt);
+	}
+	if(!strcmp(argv[1],"-transform")){
+		return batch_transform(argc,argv);
+	}
+	if(!strcmp(argv[1],"-solve-lines")){
+		return batch_solve_lines(argc,argv);
+	}
+	if(!strcmp(argv[1],"-solve-archive")){
+		return batch_solve_archive(argc,argv);
+	}
+	if(!strcmp(argv[1],"-stress")){
+		return batch_stress(argc,argv);
+	}
+	print_usage(argv[0]);
+	return 1;
+}
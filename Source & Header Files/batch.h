@@ -0,0 +1,17 @@
+/*This module handles the non-interactive modes of the program, which are selected
+ * by command line arguments (e.g. generating a large set of puzzles into a file)*/
+
+#include <stdio.h>
+#include "executer.h"
+
+struct timespec;
+
+/*Returns the number of seconds that passed since start, a CLOCK_MONOTONIC time*/
+double elapsed_seconds(struct timespec *start);
+
+/*Runs the mode selected by the command line arguments and returns the exit status of the program*/
+int run_batch(int argc, char *argv[]);
+
+/*Runs the commands read from in on the given game, printing the board only on print_board
+ * and reporting the runtime at the end*/
+int run_script(game_data *game, FILE *in);
@@ -0,0 +1,199 @@
+/*This module handles the binary board format, see binary_format.h for the layout*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "board.h"
+#include "error_handler.h"
+#include "binary_format.h"
+
+#define BINARY_MAGIC "SDKB"
+#define BINARY_VERSION 1
+#define RECORD_HEADER_SIZE 2
+
+/*Returns 1 if the path has the binary extension*/
+char is_binary_path(char *path){
+	size_t len=strlen(path),ext_len=strlen(BINARY_EXTENSION);
+	return len>ext_len && !strcmp(path+len-ext_len,BINARY_EXTENSION);
+}
+
+/*Writes the lowest size bytes of n to buffer, lowest byte first*/
+void encode_number(unsigned char *buffer, unsigned long n, int size){
+	int i;
+	for(i=0;i<size;i++){
+		buffer[i]=(unsigned char)(n&0xFF);
+		n>>=8;
+	}
+}
+
+/*Reads a number of size bytes written by encode_number*/
+unsigned long decode_number(unsigned char *buffer, int size){
+	unsigned long n=0;
+	while(size--)
+		n=(n<<8)|buffer[size];
+	return n;
+}
+
+/*Returns the 32 bit FNV-1a hash of size bytes*/
+unsigned long record_hash(unsigned char *record, size_t size){
+	unsigned long h=2166136261UL;
+	while(size--){
+		h^=*record++;
+		h=(h*16777619UL)&0xFFFFFFFFUL;
+	}
+	return h;
+}
+
+/*Writes the header of a container of count boards whose index starts at index_offset*/
+void encode_binary_header(unsigned char *buffer, unsigned long count, unsigned long index_offset){
+	memcpy(buffer,BINARY_MAGIC,4);
+	encode_number(buffer+4,BINARY_VERSION,4);
+	encode_number(buffer+8,count,4);
+	encode_number(buffer+12,0,4);
+	encode_number(buffer+16,index_offset,BINARY_OFFSET_SIZE);
+}
+
+/*Writes a 64 bit little endian number*/
+void encode_offset(unsigned char *buffer, unsigned long offset){
+	encode_number(buffer,offset,BINARY_OFFSET_SIZE);
+}
+
+/*Returns the number of bits needed for the values 0..len*/
+int value_bits(int len){
+	int bits=0;
+	while((1L<<bits)<=len)
+		bits++;
+	return bits;
+}
+
+/*Returns the size of a record of a board with the given block dimensions*/
+size_t record_size(int block_rows, int block_columns){
+	size_t len=(size_t)block_rows*block_columns;
+	return RECORD_HEADER_SIZE+(len*len*(value_bits((int)len)+1)+7)/8;
+}
+
+/*Returns the size of the record of a board, 0 if it is longer than MAX_BOARD_LEN*/
+size_t binary_record_size(game_board *board){
+	if(board_len(board)>MAX_BOARD_LEN)
+		return 0;
+	return record_size(board->block_rows,board->block_columns);
+}
+
+/*Writes the record of the board to buffer
+ * The cells are packed into an accumulator and moved out a byte at a time*/
+void encode_board(game_board *board, unsigned char *buffer){
+	int x,y,len,bits,acc_bits=0;
+	unsigned long acc=0;
+	unsigned char *p=buffer+RECORD_HEADER_SIZE;
+	len=board_len(board);
+	bits=value_bits(len)+1;
+	buffer[0]=(unsigned char)board->block_rows;
+	buffer[1]=(unsigned char)board->block_columns;
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++){
+			acc|=((unsigned long)board->cells[x][y].value<<1|board->cells[x][y].is_fixed)<<acc_bits;
+			acc_bits+=bits;
+			while(acc_bits>=8){
+				*p++=(unsigned char)(acc&0xFF);
+				acc>>=8;
+				acc_bits-=8;
+			}
+		}
+	}
+	if(acc_bits)
+		*p=(unsigned char)acc;
+}
+
+/*Unpacks the len*len cells of a record into values and fixed, row by row
+ * Returns 0 if a value is out of range*/
+char decode_cells(int len, unsigned char *p, int *values, char *fixed){
+	int i,bits,acc_bits=0;
+	unsigned long acc=0,mask;
+	bits=value_bits(len)+1;
+	mask=(1UL<<bits)-1;
+	for(i=0;i<len*len;i++){
+		while(acc_bits<bits){
+			acc|=(unsigned long)*p++<<acc_bits;
+			acc_bits+=8;
+		}
+		values[i]=(int)((acc&mask)>>1);
+		if(values[i]>len)
+			return 0;
+		fixed[i]=(char)(acc&1);
+		acc>>=bits;
+		acc_bits-=bits;
+	}
+	return 1;
+}
+
+/*Creates the board of a record, which holds record_size of its block dimensions bytes
+ * Returns a 0x0 board if the board is longer than MAX_BOARD_LEN or a value is out of range*/
+game_board decode_board(unsigned char *record){
+	game_board board;
+	int len,*values;
+	char *fixed;
+	board.block_rows=0;
+	board.block_columns=0;
+	len=record[0]*record[1];
+	if(len>MAX_BOARD_LEN)
+		return board;
+	values=(int*)malloc(sizeof(int)*(size_t)len*len);
+	fixed=(char*)malloc((size_t)len*len);
+	if(values==NULL || fixed==NULL) function_error(f_malloc);
+	if(decode_cells(len,record+RECORD_HEADER_SIZE,values,fixed))
+		board=board_from_cells(record[0],record[1],values,fixed);
+	free(values);
+	free(fixed);
+	return board;
+}
+
+/*Decodes board number index of the container in data, of size bytes
+ * Every offset is checked against the size before it is used
+ * Returns a 0x0 board if the container is invalid or has no such board*/
+game_board decode_container(unsigned char *data, size_t size, long index){
+	game_board board;
+	unsigned long count,index_offset,offset;
+	board.block_rows=0;
+	board.block_columns=0;
+	if(size<BINARY_HEADER_SIZE || memcmp(data,BINARY_MAGIC,4) || decode_number(data+4,4)!=BINARY_VERSION)
+		return board;
+	count=decode_number(data+8,4);
+	index_offset=decode_number(data+16,BINARY_OFFSET_SIZE);
+	if(index<0 || (unsigned long)index>=count || index_offset>size || (size-index_offset)/BINARY_OFFSET_SIZE<count)
+		return board;
+	offset=decode_number(data+index_offset+index*BINARY_OFFSET_SIZE,BINARY_OFFSET_SIZE);
+	if(offset>size-RECORD_HEADER_SIZE || !data[offset] || !data[offset+1]
+			|| record_size(data[offset],data[offset+1])>size-offset)
+		return board;
+	return decode_board(data+offset);
+}
+
+/*Loads board number index of the binary file at path
+ * The file is mapped to memory, so only the header, an index entry and the record itself are read*/
+game_board load_binary_board(char *path, long index){
+	int fd;
+	struct stat st;
+	unsigned char *data;
+	game_board board;
+	board.block_rows=0;
+	board.block_columns=0;
+	fd=open(path,O_RDONLY);
+	if(fd<0)
+		return board;
+	if(fstat(fd,&st) || !S_ISREG(st.st_mode) || st.st_size==0){
+		close(fd);
+		return board;
+	}
+	data=(unsigned char*)mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(data==MAP_FAILED) function_error(f_mmap);
+	board=decode_container(data,st.st_size,index);
+	munmap(data,st.st_size);
+	return board;
+}
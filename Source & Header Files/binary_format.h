@@ -0,0 +1,56 @@
+/*This module handles the binary board format, a container of any number of boards:
+ * a header, the boards as records of fixed-width packed cells, and an index of their offsets,
+ * so any board can be read without scanning the ones before it
+ *
+ * header:  "SDKB", version, board count (32 bit each), reserved (32 bit), index offset (64 bit)
+ * record:  block_rows, block_columns (a byte each), then the cells row by row, every cell takes
+ *          bits(N)+1 bits, the value followed by the fixed flag, packed from the lowest bit of each byte
+ * index:   the offset of every record (64 bit each)
+ * All the numbers are little endian*/
+
+#ifndef _BINARYFORMATH_
+#define _BINARYFORMATH_
+
+#include <stddef.h>
+#include "board.h"
+
+#define BINARY_EXTENSION ".sdb"
+#define BINARY_HEADER_SIZE 24
+#define BINARY_OFFSET_SIZE 8
+
+/*Returns 1 if the path names a file in the binary format, i.e. it has the binary extension*/
+char is_binary_path(char *path);
+
+/*Writes the header of a container of count boards whose index starts at index_offset*/
+void encode_binary_header(unsigned char *buffer, unsigned long count, unsigned long index_offset);
+
+/*Writes a 64 bit little endian number, used for the entries of the index*/
+void encode_offset(unsigned char *buffer, unsigned long offset);
+
+/*Returns the size of the record of a board with the given block dimensions*/
+size_t record_size(int block_rows, int block_columns);
+
+/*Returns the size of the record of a board, 0 if it is longer than MAX_BOARD_LEN*/
+size_t binary_record_size(game_board *board);
+
+/*Writes the record of the board to buffer, which holds binary_record_size(board) bytes*/
+void encode_board(game_board *board, unsigned char *buffer);
+
+/*Creates the board of a record written by encode_board, the caller checks that the whole record is readable
+ * Returns a 0x0 board if the board is longer than MAX_BOARD_LEN or a value is out of range*/
+game_board decode_board(unsigned char *record);
+
+/*Writes the lowest size bytes of n to buffer, lowest byte first*/
+void encode_number(unsigned char *buffer, unsigned long n, int size);
+
+/*Reads a number of size bytes written by encode_number*/
+unsigned long decode_number(unsigned char *buffer, int size);
+
+/*Returns a 32 bit hash of size bytes, e.g. of a record, so boards can be looked up by their records*/
+unsigned long record_hash(unsigned char *record, size_t size);
+
+/*Loads board number index (counting from 0) of the binary file at path
+ * Returns a 0x0 board if the file can't be read, isn't a valid container or has no such board*/
+game_board load_binary_board(char *path, long index);
+
+#endif
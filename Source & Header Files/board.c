@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "error_handler.h"
 #include "stack_tools.h"
 
@@ -39,13 +40,11 @@ void get_cell_in_block(game_board *board,int block_index, int cell_index,int *ce
 	*cell_y = block_y * board->block_rows + y_in_block;
 }
 
-/*Prints a separating line between rows of blocks*/
-void print_sep_line(int len){
-	int i;
-	for(i = 0; i < len; i++){
-		printf("-");
-	}
-	printf("\n");
+/*Writes a separating line between rows of blocks to p, returns the end of the line*/
+char *render_sep_line(char *p, int len){
+	memset(p,'-',len);
+	p[len]='\n';
+	return p+len+1;
 }
 
 /*Returns 1 if the given cell is erroneous, otherwise returns 0*/
@@ -57,46 +56,67 @@ char is_erronous(game_board *board, int x, int y){
 			board->values_in_block[get_block_index(board,x,y)][cell_value] >= 2;
 }
 
-/*Prints the string representation of the cell in position x,y of the board*/
-void print_cell(game_board *board,char mark_fixed,char mark_errors, int x,int y){
+/*Writes the string representation of the cell in position x,y of the board to text, returns its length*/
+int format_cell(game_board *board,char mark_fixed,char mark_errors,int x,int y,char *text){
+	int n;
 	if(board->cells[x][y].value == 0){
 		/*cell is empty*/
-		printf("    ");
-		return;
+		memset(text,' ',CELL_WIDTH);
+		return CELL_WIDTH;
 	}
 
-	printf(" %2d",board->cells[x][y].value);
+	n=sprintf(text," %2d",board->cells[x][y].value);
 	if(board->cells[x][y].is_fixed && mark_fixed){
-		printf(".");
+		text[n]='.';
 	}else if(is_erronous(board,x,y) && mark_errors){
-		printf("*");
+		text[n]='*';
 	}else{
-		printf(" ");
+		text[n]=' ';
 	}
+	return n+1;
 }
 
-/*Prints the string representation of the game board
+/*Writes the string representation of the game board to a new buffer, its size is put in *size
   Goes row by row, block by block, left to right, up to down,
-  prints separating characters where needed*/
-
-void print_board(game_board *board,char mark_fixed,char mark_errors){
-	int i,j,k,t;
-	print_sep_line(get_sep_line_len(board));
+  writes separating characters where needed*/
+char *render_board(game_board *board,char mark_fixed,char mark_errors,size_t *size){
+	int i,j,k,t,sep_len,extra;
+	char *buffer,*p,digits[12];
+	sep_len=get_sep_line_len(board);
+	extra=sprintf(digits,"%d",board_len(board))-2; /*Values of more than 2 digits widen their cells*/
+	if(extra<0) extra=0;
+	buffer=(char*)malloc((size_t)(board_len(board)+board->blocks_per_column+1)*(sep_len+1)
+			+(size_t)board_len(board)*board_len(board)*extra);
+	if(buffer==NULL) function_error(f_malloc);
+	p=render_sep_line(buffer,sep_len);
 	for(i = 0; i < board->blocks_per_column; i++){
-		/*print line of blocks*/
+		/*line of blocks*/
 		for(j = 0; j < board->block_rows; j++){
-			/*print line*/
+			/*line*/
 			for(k = 0; k < board->blocks_per_row; k++){
-				printf("|"); /*End of row in a block*/
+				*p++='|'; /*End of row in a block*/
 				for(t = 0; t < board->block_columns; t++){
-					print_cell(board,mark_fixed,mark_errors,k * board->block_columns + t,i * board->block_rows + j);
+					p+=format_cell(board,mark_fixed,mark_errors,k * board->block_columns + t,i * board->block_rows + j,p);
 				}
 			}
-			printf("|\n"); /*End of row in a block and end of line*/
+			*p++='|'; /*End of row in a block and end of line*/
+			*p++='\n';
 		}
-		print_sep_line(get_sep_line_len(board)); /*End of a line of blocks, prints separator line*/
+		p=render_sep_line(p,sep_len); /*End of a line of blocks, separator line*/
 	}
-	fflush(stdout);
+	*size=p-buffer;
+	return buffer;
+}
+
+/*Prints the string representation of the game board to out
+ * The whole board is rendered first and written at once*/
+void print_board(game_board *board,char mark_fixed,char mark_errors,FILE *out){
+	char *buffer;
+	size_t size;
+	buffer=render_board(board,mark_fixed,mark_errors,&size);
+	fwrite(buffer,1,size,out);
+	free(buffer);
+	fflush(out);
 }
 
 void update_value_var(game_board *board, char *value, int delta){
@@ -114,6 +134,7 @@ void update_value_var(game_board *board, char *value, int delta){
  */
 void set_board_values(game_board *board,int x,int y, int block_index,int value, char set){
 	int delta;
+	if(value == 0) return; /*Empty cells are not counted, otherwise the counters of 0 would overflow on long runs*/
 	if(set) delta = 1;
 
 	else delta = -1;
@@ -160,20 +181,84 @@ char set_cell(game_board *board, int x, int y,int value){
 	return 0;
 }
 
-/*Clears a cell, i.e. setting it to be empty and not fixed*/
-void clear_cell(game_board *board,int x, int y){
-	set_cell(board,x,y,0);
-	board->cells[x][y].is_fixed = 0;
+/*Zeroes the values_in_x arrays, the errors and the empty cells count*/
+void clear_counters(game_board *board){
+	int i,len;
+	len=board_len(board);
+	for(i=0;i<len;i++){
+		memset(board->values_in_row[i],0,len+1);
+		memset(board->values_in_column[i],0,len+1);
+		memset(board->values_in_block[i],0,len+1);
+	}
+	board->empty_cells=0;
+	board->errors=0;
+}
+
+/*Adds the cells of column x to the counters of the board
+ * The column is swept one band of blocks at a time, so the block of a cell is known without a division,
+ * and a value is counted as an error the moment its counter reaches 2*/
+void count_column(game_board *board, int x){
+	int y,v,band,block;
+	char *in_column,*in_block;
+	game_cell *column;
+	column=board->cells[x];
+	in_column=board->values_in_column[x];
+	block=x/board->block_columns;
+	for(band=0;band<board_len(board);band+=board->block_rows,block+=board->blocks_per_row){
+		in_block=board->values_in_block[block];
+		for(y=band;y<band+board->block_rows;y++){
+			v=column[y].value;
+			if(v==0){
+				board->empty_cells++;
+				continue;
+			}
+			board->errors+=(++board->values_in_row[y][v]==2)+(++in_column[v]==2)+(++in_block[v]==2);
+		}
+	}
+}
+
+/*Recomputes the values_in_x arrays, the errors and the empty cells count from the cells themselves
+ * Used after the cells were written directly, which is much faster than calling set_cell for each of them*/
+void recount_board(game_board *board){
+	int x;
+	clear_counters(board);
+	for(x=0;x<board_len(board);x++)
+		count_column(board,x);
+}
+
+/*Sets every cell of the board from values and fixed, given row by row
+ * Every column is counted right after it is written, while it is still in the cache*/
+void set_board_cells(game_board *board, int *values, char *fixed){
+	int x,y,len;
+	game_cell *column;
+	len=board_len(board);
+	clear_counters(board);
+	for(x=0;x<len;x++){
+		column=board->cells[x];
+		for(y=0;y<len;y++){
+			column[y].value=values[y*len+x];
+			column[y].is_fixed=(fixed!=NULL && fixed[y*len+x]);
+		}
+		count_column(board,x);
+	}
+}
+
+/*Creates a board with the given block dimensions whose cells are set from values and fixed*/
+game_board board_from_cells(int block_rows, int block_columns, int *values, char *fixed){
+	game_board board;
+	board=create_board(block_rows,block_columns);
+	set_board_cells(&board,values,fixed);
+	return board;
 }
 
 /*Clears the entire board*/
 void clear_board(game_board *board){
-	int i,j;
+	int i;
 	for(i = 0; i < board_len(board); i++){
-		for(j = 0; j < board_len(board); j++){
-			clear_cell(board,i,j);
-		}
+		memset(board->cells[i],0,sizeof(game_cell)*board_len(board));
 	}
+	clear_counters(board);
+	board->empty_cells=board_len(board)*board_len(board);
 }
 
 /*Creates and empty game_board struct, initialising a matrix for the cells and
@@ -273,33 +358,15 @@ void free_board(game_board *board){
  * assumes boards are of the same dimensions*/
 void copy_board(game_board *source, game_board *target)
 {
-	int i,j;
+	int i,len;
+	len=board_len(source);
 	target->empty_cells=source->empty_cells;
 	target->errors=source->errors;
-	for(i=0;i<board_len(source);i++){
-		for(j=0;j<board_len(source);j++){
-			target->cells[i][j].value=source->cells[i][j].value;
-			target->cells[i][j].is_fixed=source->cells[i][j].is_fixed;
-			target->values_in_block[i][j+1]=source->values_in_block[i][j+1];
-			target->values_in_row[i][j+1]=source->values_in_row[i][j+1];
-			target->values_in_column[i][j+1]=source->values_in_column[i][j+1];
-		}
-	}
-}
-
-/*Randomly selects the given amount of cells and sets them to be fixed*/
-void fix_random_cells(game_board *board,int cell_num)
-{
-	int cnt,x,y;
-	for(cnt=0;cnt<cell_num;)
-	{
-		x=rand()%board_len(board);
-		y=rand()%board_len(board);
-		if(!board->cells[x][y].is_fixed)
-		{
-			board->cells[x][y].is_fixed=1;
-			cnt++;
-		}
+	for(i=0;i<len;i++){ /*Every array is copied as a whole*/
+		memcpy(target->cells[i],source->cells[i],sizeof(game_cell)*len);
+		memcpy(target->values_in_block[i],source->values_in_block[i],len+1);
+		memcpy(target->values_in_row[i],source->values_in_row[i],len+1);
+		memcpy(target->values_in_column[i],source->values_in_column[i],len+1);
 	}
 }
 
@@ -312,10 +379,11 @@ void clear_non_fixed(game_board *board)
 		for(y=0;y<board_len(board);y++){
 			if(!board->cells[x][y].is_fixed)
 			{
-				clear_cell(board,x,y);
+				board->cells[x][y].value=0;
 			}
 		}
 	}
+	recount_board(board);
 }
 
 
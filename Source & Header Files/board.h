@@ -4,6 +4,8 @@
 #ifndef _GAMEH_
 #define _GAMEH_
 
+#include <stdio.h>
+
 #define blocks_per_row  block_rows       /*Board dimensions*/
 #define blocks_per_column block_columns        /*Board dimensions*/
 
@@ -38,8 +40,31 @@ game_board create_board(int block_rows,int block_columns);
 /*Returns the length of the board, i.e. the number of cells in a block*/
 int board_len(game_board *board);
 
+#define MAX_BOARD_LEN 127 /*Longest board the loaders accept, the char counters of a board count up to its length*/
+
+#define CELL_WIDTH 4 /*Characters a cell takes when the board is printed, while its values have up to 2 digits*/
+
 /*Prints the board in the given format*/
-void print_board(game_board *board,char mark_fixed,char mark_errors);
+void print_board(game_board *board,char mark_fixed,char mark_errors,FILE *out);
+
+/*Returns a new buffer holding the board as print_board prints it, its size is put in *size*/
+char *render_board(game_board *board,char mark_fixed,char mark_errors,size_t *size);
+
+/*Writes cell <x,y> as print_board prints it to text, which holds at least CELL_WIDTH+1 characters
+ * (more for values of more than 2 digits). Returns the number of characters of the cell*/
+int format_cell(game_board *board,char mark_fixed,char mark_errors,int x,int y,char *text);
+
+/*Recomputes the values_in_x arrays, errors and empty_cells after the cells were written directly*/
+void recount_board(game_board *board);
+
+/*Sets every cell of the board from values and fixed, given row by row (cell <x,y> is y*len+x),
+ * fixed may be NULL if no cell is fixed. The values_in_x arrays, errors and empty_cells are built
+ * in the same sweep. Assumes every value is in the range 0-len*/
+void set_board_cells(game_board *board, int *values, char *fixed);
+
+/*Creates a board with the given block dimensions from the values and fixed flags of its cells,
+ * see set_board_cells*/
+game_board board_from_cells(int block_rows, int block_columns, int *values, char *fixed);
 
 /*Sets all the cells on the board to be empty and non-fixed*/
 void clear_board(game_board *board);
@@ -60,12 +85,12 @@ void fix_all_cells(game_board *board);
  * Assumes the two boards are of the same dimensions*/
 void copy_board(game_board *source, game_board *target);
 
-/*Fixes random cells, as many as the hints parameter indicates*/
-void fix_random_cells(game_board *board, int hints);
-
 /*Clears all cells that are not fixed*/
 void clear_non_fixed(game_board *board);
 
+/*Returns the index of the block in which the cell <x,y> is located*/
+int get_block_index(game_board *board,int x,int y);
+
 /*Puts the coordinates of the cell_index cell of block block_index in (cell_x,cell_y)*/
 void get_cell_in_block(game_board *board,int block_index, int cell_index,int *cell_x, int *cell_y);
 
@@ -39,6 +39,21 @@ void function_error(failable_function func){
         case f_fread:
         	function_name = "fread";
         	break;
+        case f_pipe:
+        	function_name = "pipe";
+        	break;
+        case f_fork:
+        	function_name = "fork";
+        	break;
+        case f_poll:
+        	function_name = "poll";
+        	break;
+        case f_thread:
+        	function_name = "pthread_create";
+        	break;
+        case f_mmap:
+        	function_name = "mmap";
+        	break;
     }
     printf("Error: %s has failed\n",function_name);
     exit(1);
@@ -1,12 +1,17 @@
 /*This module handles function error prompting*/
 
+#ifndef _ERRORHANDLERH_
+#define _ERRORHANDLERH_
+
 #define MAX_INPUT_LEN 256
 
 /*An enum representing all the functions that can cause a failure*/
 typedef enum failable_function{
-    f_malloc,f_scanf,f_calloc,f_fgets,f_fopen,f_fprintf,f_fseek,f_ftell,f_fread
+    f_malloc,f_scanf,f_calloc,f_fgets,f_fopen,f_fprintf,f_fseek,f_ftell,f_fread,f_pipe,f_fork,f_poll,f_thread,f_mmap
 } failable_function;
 
 
 /*Prints an error fuction prompt for a failed function and exits the program*/
 void function_error(failable_function func);
+
+#endif
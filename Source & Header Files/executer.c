@@ -3,25 +3,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "parser.h"
-#include "stack_tools.h"
 #include "exhaustive_solver.h"
 #include "error_handler.h"
 #include "executer.h"
 #include "file_operations.h"
+#include "binary_format.h"
+#include "archive.h"
 #include "board.h"
 #include "ILPsolver.h"
+#include "generator.h"
+#include "puzzle_pool.h"
+#include "autofill.h"
+#include "journal.h"
+#include "job.h"
+#include "solution_cache.h"
+#include "save_queue.h"
+#include "screen.h"
 
 #define INIT_C (game->state==init)
 #define EDIT_C (game->state==edit)
 #define SOLVE_C (game->state==solve)
 #define UNDO 0
 #define REDO 1
-#define FIRST_TIME 2
-#define ON_RESET 3
 #define RANGE(x) (x>=0 && x<=board_len(&game->board)-1)
 #define DEFAULT_SIZE 3
 #define UNSOLVABLE (!sol.block_rows)
-#define MAX_GENERATE_ATTEMPTS 1000
 
 
 /*Returns 1 if the command is considered valid in the current game mode,
@@ -36,6 +42,9 @@ char check_mode_compatibility(game_data *game,func_name com)
 	case undo:
 	case p_board:
 	case redo:
+	case goto_move:
+	case checkout:
+	case list_versions:
 	case save:
 	case num_solutions:return EDIT_C || SOLVE_C;
 	case hint:
@@ -43,6 +52,8 @@ char check_mode_compatibility(game_data *game,func_name com)
 	case autofill:return SOLVE_C;
 	case ex:
 	case invalid:
+	case job_status:
+	case job_cancel:
 	case solve_command:
 	case edit_command: return 1;
 	case generate: return EDIT_C;
@@ -51,477 +62,767 @@ char check_mode_compatibility(game_data *game,func_name com)
 
 	return 0;
 }
-/*Returns a 2d array that represent the values to be autofilled
- * Such that, for every arr[3] in the stack, it holds that:
- * arr[0]=x coordinate
- * arr[1]=y coordinate
- * arr[2]=value to fill
- * NULL pointer indicates the end of the list*/
-int **get_autofill_cells(game_board *board)
-{
-	Stack stk;
-	int *arr;
-	int *valid_values;
-	int x,y,amount,i;
-	int **res;
-
-	x=board_len(board)-1;
-	y=board_len(board)-1;
-	stk=create_stack();
-	/*The cells are inserted into the stack in reverse order so they're popped
-	 * out in the right order*/
-	while(y>=0)
-	{
-		if(!board->cells[x][y].is_fixed && board->cells[x][y].value == 0){
-			valid_values=get_valid_values(board,x,y);
-			if(valid_values[0] && !valid_values[1])
-			{
-				arr=(int*)malloc(sizeof(int)*3);
-				if(arr==NULL)
-					function_error(f_malloc);
-				arr[0]=x;
-				arr[1]=y;
-				arr[2]=valid_values[0];
-				push(&stk,arr);
-			}
-			free(valid_values);
-		}
-		/*Advancing to the next cell*/
-		if(x==0){
-			x=board_len(board)-1;
-			y--;
-		}
-		else{
-			x--;
-		}
+/*Prints the board after a command changed it, unless only print_board should print it
+ * On a terminal where the board is pinned, only the cells that changed are repainted*/
+void show_board(game_data *game){
+	if(game->quiet)
+		return;
+	if(game->screen!=NULL && draw_screen(game->screen,&game->board,game->state == solve,game->mark_errors))
+		return;
+	print_board(&game->board,game->state == solve,game->mark_errors,game->out);
+}
+
+/*Updates the pinned board after the changes the commands made without showing the board, see executer.h*/
+void update_screen(game_data *game){
+	if(game->screen==NULL || game->job!=NULL) /*The job may be printing*/
+		return;
+	if(game->state == init)
+		release_screen(game->screen);
+	else
+		draw_screen(game->screen,&game->board,game->state == solve,game->mark_errors);
+}
+
+/*Adds the state of cell <x,y> to the journal of the game, if it keeps one*/
+void journal_board_cell(game_data *game, int x, int y){
+	if(game->journal!=NULL)
+		journal_cell(game->journal,y*board_len(&game->board)+x,game->board.cells[x][y].value,game->board.cells[x][y].is_fixed);
+}
+
+/*Adds every cell to the journal, after the board was replaced as a whole*/
+void journal_board(game_data *game){
+	int x,y,len;
+	len=board_len(&game->board);
+	for(x=0;x<len && game->journal!=NULL;x++){
+		for(y=0;y<len;y++)
+			journal_board_cell(game,x,y);
+	}
+}
+
+/*Prints the undo/redo prompt of a single delta*/
+void print_delta(game_data *game, cell_delta *d, char mode){
+	int len;
+	len=board_len(&game->board);
+	if(mode==UNDO)
+		print_undo_redo_prompt(d->cell%len+1,d->cell/len+1,d->new_value,d->old_value,UNDO,game->out);
+	else
+		print_undo_redo_prompt(d->cell%len+1,d->cell/len+1,d->old_value,d->new_value,REDO,game->out);
+}
+
+/*Applies the deltas [start,end) of a single move to the board
+ * mode determines whether the move is being undone (UNDO) or redone (REDO)
+ * If print is set, prints the undo/redo prompt of every delta
+ * The cells of a move are distinct, so the order of the deltas doesn't matter*/
+void apply_deltas(game_data *game, int start, int end, char mode, char print){
+	int i,x,y,len;
+	cell_delta *d;
+	len=board_len(&game->board);
+	for(i=start;i<end;i++){
+		d=&game->hist.deltas[i];
+		x=d->cell%len;
+		y=d->cell/len;
+		set_cell(&game->board,x,y,mode==UNDO?d->old_value:d->new_value);
+		game->board.cells[x][y].is_fixed=(mode==UNDO)?d->old_fixed:d->new_fixed;
+		journal_board_cell(game,x,y);
+		if(print)
+			print_delta(game,d,mode);
 	}
+}
 
-	amount=stk.size;
-	if(!amount)
-		return NULL;
-	res=(int**)malloc(sizeof(int*)*(amount+1));
-	if(res==NULL)function_error(f_malloc);
+/*Sets the cell <x,y> to value, recording the change in the move being recorded*/
+void record_set(game_data *game, int x, int y, int value){
+	int old_value;
+	char old_fixed;
+	old_value=game->board.cells[x][y].value;
+	old_fixed=game->board.cells[x][y].is_fixed;
+	set_cell(&game->board,x,y,value);
+	record_delta(&game->hist,y*board_len(&game->board)+x,old_value,value,old_fixed,game->board.cells[x][y].is_fixed);
+	journal_board_cell(game,x,y);
+}
 
-	for(i=0;i<amount;i++)
-		res[i]=(int*)pop(&stk);
-	res[amount]=NULL; /*Indicates the end of list*/
+/*Ends the move being recorded and makes the board after it a new version,
+ * a child of the version the move started from*/
+void finish_move(game_data *game){
+	int start;
+	history *h=&game->hist;
+	end_move(h,&game->board);
+	start=h->moves[h->move_count-1].start;
+	game->version=add_version(&game->versions,game->version,&game->board,h->deltas+start,h->count-start);
+	h->moves[h->move_count-1].version=game->version;
+}
 
-	return res;
+/*Updates the current version after moving along the history*/
+void sync_version(game_data *game){
+	history *h=&game->hist;
+	game->version=h->current_move?h->moves[h->current_move-1].version:0;
 }
 
-/*Fills the board with the values given by the 2d array
- * mode determines whether the autofill action is:
- * 0 - Being undone
- * 1 - Being redone
- * 2 - Being performed for the first time
- * else - Being performed as part of a reset command (shouldn't print anything)
- *
+/*Fills the board with the values given by the 2d array (see get_autofill_cells), records them as a
+ * single move and frees the array. The cells may already be filled by the autofill search itself
  * Returns 1 if changes were made (i.e. at least one cell was changed), otherwise returns 0*/
-
-char autofill_board(game_board *board,int **fills, char mode)
+char autofill_board(game_data *game, int **fills)
 {
-	if(fills!=NULL){
-	for(;*fills!=NULL;fills++){
-		set_cell(board,(*fills)[0],(*fills)[1],(mode==REDO || mode==FIRST_TIME)?(*fills)[2]:0);
-		switch(mode){
-		case UNDO:
-			print_undo_redo_prompt((*fills)[0]+1,(*fills)[1]+1,(*fills)[2],0,UNDO);
-			break;
-		case REDO:
-			print_undo_redo_prompt((*fills)[0]+1,(*fills)[1]+1,0,(*fills)[2],REDO);
-			break;
-		case FIRST_TIME:
-			printf("Cell <%d,%d> set to %d\n",(*fills)[0]+1,(*fills)[1]+1,(*fills)[2]);
-			break;
-		}
+	int **p;
+	if(fills==NULL)
+		return 0;
+	begin_move(&game->hist,MOVE_MULTI);
+	for(p=fills;*p!=NULL;p++){
+		set_cell(&game->board,(*p)[0],(*p)[1],(*p)[2]);
+		record_delta(&game->hist,(*p)[1]*board_len(&game->board)+(*p)[0],0,(*p)[2],0,0); /*Autofill only fills empty cells*/
+		journal_board_cell(game,(*p)[0],(*p)[1]);
+		fprintf(game->out,"Cell <%d,%d> set to %d\n",(*p)[0]+1,(*p)[1]+1,(*p)[2]);
 	}
+	finish_move(game);
+	free_fills(fills);
 	return 1;
+}
+
+/*Starts journaling the changes of the game next to the board file at path, if journaling is on
+ * The journal of the previous file is deleted, restart empties the journal of the new one*/
+void start_journal(game_data *game, char *path, char restart){
+	if(game->journal_fsync==JOURNAL_OFF)
+		return;
+	if(game->journal!=NULL)
+		close_journal(game->journal,1);
+	game->journal=open_journal(path,board_len(&game->board),game->journal_fsync,restart);
+	if(game->journal==NULL)
+		fprintf(game->out,"Error: journal cannot be opened, changes are not journaled\n");
+}
+
+/*Adds the cells whose state differs from their state on board to the journal*/
+void journal_changes(game_data *game, game_board *board){
+	int x,y,len;
+	len=board_len(&game->board);
+	for(x=0;x<len && game->journal!=NULL;x++){
+		for(y=0;y<len;y++){
+			if(game->board.cells[x][y].value!=board->cells[x][y].value ||
+					game->board.cells[x][y].is_fixed!=board->cells[x][y].is_fixed)
+				journal_board_cell(game,x,y);
+		}
 	}
-	else
-		return 0;
+}
+
+/*Reports the saves the I/O thread is done with, see executer.h
+ * The saved file holds all the changes up to the save, so the journal restarts from it
+ * with the cells that were changed since*/
+void report_saves(game_data *game){
+	save_result result;
+	if(game->saves==NULL || game->job!=NULL) /*A job may hold the journal*/
+		return;
+	while(next_save_result(game->saves,&result)){
+		if(result.saved){
+			fprintf(game->out,"Saved to: %s\n",result.path);
+			if(game->state!=init){
+				start_journal(game,result.path,1);
+				journal_changes(game,&result.board);
+				if(game->journal!=NULL && journal_commit(game->journal))
+					fprintf(game->out,"Error: journal cannot be written, changes are no longer journaled\n");
+			}
+		}else{
+			fprintf(game->out,"Error: File cannot be created or modified\n");
+		}
+		free(result.path);
+		free_board(&result.board);
+	}
+}
 
+/*Waits for the saves of the game that are still queued and reports them*/
+void finish_saves(game_data *game){
+	if(game->saves==NULL || game->job!=NULL)
+		return;
+	wait_for_saves(game->saves);
+	report_saves(game);
 }
 
 /*Frees the game_data struct elements*/
 void free_game_data(game_data *game){
 	if(game->state == init) return;
+	finish_saves(game);
 	free_board(&game->board);
-	empty_stack(&game->undo_stack);
-	empty_stack(&game->redo_stack);
+	free_board(&game->initial);
+	free_versions(&game->versions);
+	clear_history(&game->hist);
+	if(game->journal!=NULL){
+		close_journal(game->journal,0);
+		game->journal=NULL;
+	}
+}
+
+/*Ends a game whose puzzle was solved, its journal is no longer needed*/
+void end_solved_game(game_data *game){
+	fprintf(game->out,"Puzzle solved successfully\n");
+	finish_saves(game); /*Before the journal is deleted, a save that is done restarts it*/
+	if(game->journal!=NULL){
+		close_journal(game->journal,1);
+		game->journal=NULL;
+	}
+	free_game_data(game);
+	game->state=init;
+}
+
+/*In solve mode, reports whether a full board is solved or erroneous. A solved board ends the game*/
+void check_solved(game_data *game){
+	if(game->state==solve){
+		if(!game->board.empty_cells && !game->board.errors)
+			end_solved_game(game);
+		if(!game->board.empty_cells && game->board.errors){
+			fprintf(game->out,"Puzzle solution erroneous\n");
+		}
+	}
 }
 
 void execute_set(game_data *game,commandInfo *com){
 	if(!RANGE(com->args[0]) || !RANGE(com->args[1]) || !(RANGE(com->args[2]) || com->args[2]==board_len(&game->board))){
-		printf("Error: value not in range 0-%d\n",board_len(&game->board));
-		free_command(com);
+		fprintf(game->out,"Error: value not in range 0-%d\n",board_len(&game->board));
 		return;
 	}
 	if(game->state == solve && game->board.cells[com->args[0]][com->args[1]].is_fixed){
-		printf("Error: cell is fixed\n");
-		free_command(com);
+		fprintf(game->out,"Error: cell is fixed\n");
 	}
 	else{
-		com->prev_value=game->board.cells[com->args[0]][com->args[1]].value; /*Sets the current value of the cell to be the previous, in case this command is undone*/
-		set_cell(&game->board,com->args[0],com->args[1],com->args[2]);
-		print_board(&game->board,game->state == solve,game->mark_errors);
-		push(&game->undo_stack,com);
-		empty_stack(&game->redo_stack); /*After a set command, no moves can be redone*/
-		if(game->state==solve){
-			if(!game->board.empty_cells && !game->board.errors){
-				printf("Puzzle solved successfully\n");
-				free_game_data(game);
-				game->state=init;
-			}
-			if(!game->board.empty_cells && game->board.errors){
-				printf("Puzzle solution erroneous\n");
-			}
+		begin_move(&game->hist,MOVE_SET); /*After a set command, no moves can be redone*/
+		record_set(game,com->args[0],com->args[1],com->args[2]);
+		finish_move(game);
+		show_board(game);
+		check_solved(game);
+	}
+}
+
+/*Brings the board to the state after the first target moves, printing it once
+ * Starts from the closest of the current board and the checkpoints, so at most a checkpoint
+ * interval worth of moves is replayed no matter how far the target is*/
+void jump_to_move(game_data *game, int target){
+	int start,end;
+	checkpoint *cp;
+	if(closest_checkpoint(&game->hist,target,&cp)<abs(game->hist.current_move-target)){
+		if(cp==NULL){
+			copy_board(&game->initial,&game->board);
+			set_current_move(&game->hist,0);
 		}
+		else
+			restore_checkpoint(&game->hist,cp,&game->board);
+		journal_board(game);
+	}
+	while(game->hist.current_move>target){
+		undo_move(&game->hist,&start,&end);
+		apply_deltas(game,start,end,UNDO,0);
+	}
+	while(game->hist.current_move<target){
+		redo_move(&game->hist,&start,&end);
+		apply_deltas(game,start,end,REDO,0);
 	}
+	sync_version(game);
+	show_board(game);
 }
 
+/*Undoes a set move: the board is printed before the prompt
+ * An autofill/generate move: the prompts are printed before the board
+ * undo N undoes N moves at once and only prints the board*/
 void execute_undo(game_data *game, commandInfo *com){
-	commandInfo *undo_move;
-	undo_move=(commandInfo*)pop(&game->undo_stack);
-	if(undo_move==NULL){
-		printf("Error: no moves to undo\n");
-		free_command(com);
+	int start,end;
+	char kind;
+	if(com->tokens[0]!=NULL){
+		if(com->args[0]<0 || com->args[0]>game->hist.current_move)
+			fprintf(game->out,"Error: value not in range 0-%d\n",game->hist.current_move);
+		else
+			jump_to_move(game,game->hist.current_move-com->args[0]);
+		return;
+	}
+	kind=undo_move(&game->hist,&start,&end);
+	if(!kind){
+		fprintf(game->out,"Error: no moves to undo\n");
 		return;
 	}
-	if(undo_move->commandName==set){
-		set_cell(&game->board,undo_move->args[0],undo_move->args[1],undo_move->prev_value);
-		print_board(&game->board,game->state == solve,game->mark_errors);
-		print_undo_redo_prompt(undo_move->args[0]+1,undo_move->args[1]+1,undo_move->args[2],undo_move->prev_value,UNDO);
+	sync_version(game);
+	if(kind==MOVE_SET){
+		apply_deltas(game,start,end,UNDO,0);
+		show_board(game);
+		print_delta(game,&game->hist.deltas[start],UNDO);
 	}
-	else if(undo_move->commandName==autofill || undo_move->commandName==generate){
-		autofill_board(&game->board,undo_move->autofill_values,UNDO);
-		print_board(&game->board,game->state == solve,game->mark_errors);
+	else{
+		apply_deltas(game,start,end,UNDO,1);
+		show_board(game);
 	}
-	push(&game->redo_stack,undo_move);
-	free_command(com);
 }
 
-void execute_redo(game_data *game, commandInfo *com){
-	commandInfo *redo_move;
-	redo_move=(commandInfo*)pop(&game->redo_stack);
-	if(redo_move==NULL){
-		printf("Error: no moves to redo\n");
-		free_command(com);
+void execute_redo(game_data *game){
+	int start,end;
+	char kind;
+	kind=redo_move(&game->hist,&start,&end);
+	if(!kind){
+		fprintf(game->out,"Error: no moves to redo\n");
 		return;
 	}
-	if(redo_move->commandName==set){
-		set_cell(&game->board,redo_move->args[0],redo_move->args[1],redo_move->args[2]);
-		print_board(&game->board,game->state == solve,game->mark_errors);
-		print_undo_redo_prompt(redo_move->args[0]+1,redo_move->args[1]+1,redo_move->prev_value,redo_move->args[2],REDO);
+	sync_version(game);
+	if(kind==MOVE_SET){
+		apply_deltas(game,start,end,REDO,0);
+		show_board(game);
+		print_delta(game,&game->hist.deltas[start],REDO);
 	}
-	else if(redo_move->commandName==autofill || redo_move->commandName==generate){
-		autofill_board(&game->board,redo_move->autofill_values,REDO);
-		print_board(&game->board,game->state == solve,game->mark_errors);
+	else{
+		apply_deltas(game,start,end,REDO,1);
+		show_board(game);
+	}
+}
+
+/*Moves to the state after the first N moves, 0 being the board as it was loaded
+ * Moves after N can still be redone*/
+void execute_goto_move(game_data *game, commandInfo *com){
+	if(com->args[0]<0 || com->args[0]>game->hist.move_count)
+		fprintf(game->out,"Error: value not in range 0-%d\n",game->hist.move_count);
+	else
+		jump_to_move(game,com->args[0]);
+}
+
+/*Returns 1 if a cell of the board differs from the given version
+ * Only the columns the current version doesn't share with it are compared*/
+char differs_from_version(game_data *game, int target){
+	int x,y,len;
+	game_cell *cell;
+	len=board_len(&game->board);
+	for(x=0;x<len;x++){
+		if(same_column(&game->versions,game->version,target,x))
+			continue;
+		for(y=0;y<len;y++){
+			cell=version_cell(&game->versions,target,x,y);
+			if(cell->value!=game->board.cells[x][y].value || cell->is_fixed!=game->board.cells[x][y].is_fixed)
+				return 1;
+		}
 	}
-	push(&game->undo_stack,redo_move);
-	free_command(com);
+	return 0;
 }
 
-void execute_reset(game_data *game, commandInfo *com){
-	commandInfo *undo_move;
-	empty_stack(&game->redo_stack);
-	while(game->undo_stack.size){
-		undo_move=pop(&game->undo_stack);
-		if(undo_move->commandName==set)
-			set_cell(&game->board,undo_move->args[0],undo_move->args[1],undo_move->prev_value);
-		else if(undo_move->commandName==autofill || undo_move->commandName == generate)
-			autofill_board(&game->board,undo_move->autofill_values,ON_RESET);
-		free_command(undo_move);
+/*Brings the board to the given version, as a single move that can be undone
+ * Only the columns the two versions don't share are compared, and no move is recorded if no cell changes
+ * Moves made afterwards branch off the checked out version*/
+void execute_checkout(game_data *game, commandInfo *com){
+	int x,y,len,target;
+	game_cell *cell;
+	target=com->args[0];
+	if(target<0 || target>=game->versions.count){
+		fprintf(game->out,"Error: value not in range 0-%d\n",game->versions.count-1);
+		return;
+	}
+	if(!differs_from_version(game,target)){ /*An empty move would make undo do nothing*/
+		game->version=target;
+		show_board(game);
+		return;
+	}
+	len=board_len(&game->board);
+	begin_move(&game->hist,MOVE_MULTI);
+	for(x=0;x<len;x++){
+		if(same_column(&game->versions,game->version,target,x))
+			continue;
+		for(y=0;y<len;y++){
+			cell=version_cell(&game->versions,target,x,y);
+			if(cell->value!=game->board.cells[x][y].value || cell->is_fixed!=game->board.cells[x][y].is_fixed){
+				record_set(game,x,y,cell->value);
+				game->board.cells[x][y].is_fixed=cell->is_fixed;
+				game->hist.deltas[game->hist.count-1].new_fixed=cell->is_fixed;
+				journal_board_cell(game,x,y);
+			}
+		}
+	}
+	end_move(&game->hist,&game->board);
+	game->hist.moves[game->hist.move_count-1].version=target;
+	game->version=target;
+	show_board(game);
+	check_solved(game);
+}
 
+/*Lists the versions of the board, each with the version it was made from*/
+void execute_versions(game_data *game){
+	int i;
+	for(i=0;i<game->versions.count;i++){
+		if(i==0)
+			fprintf(game->out,"Version 0: loaded board");
+		else
+			fprintf(game->out,"Version %d: from version %d",i,game->versions.versions[i].parent);
+		fprintf(game->out,i==game->version?" (current)\n":"\n");
 	}
-	printf("Board reset\n");
-	free_command(com);
+}
+
+/*Returns to the board as it was loaded, with a single copy instead of undoing every move*/
+void execute_reset(game_data *game){
+	copy_board(&game->initial,&game->board);
+	clear_history(&game->hist);
+	game->version=0;
+	journal_board(game);
+	fprintf(game->out,"Board reset\n");
 }
 
 void execute_mark_errors(game_data *game,commandInfo *com){
 	if(com->args[0]!=0 && com->args[0]!=1){
-		printf("Error: the value should be 0 or 1\n");
-		free_command(com);
+		fprintf(game->out,"Error: the value should be 0 or 1\n");
 		return;
 	}
 	game->mark_errors=(char)com->args[0];
-	free_command(com);
 }
 
-void execute_print_board(game_data *game, commandInfo *com){
-	print_board(&game->board,game->state == solve,game->mark_errors);
-	free_command(com);
+void execute_print_board(game_data *game){
+	print_board(&game->board,game->state == solve,game->mark_errors,game->out);
 }
 
 void execute_autofill(game_data *game, commandInfo *com){
 	char changed; /*Indicates whether the autofill has made any changes to the board*/
 	if(!game->board.errors){
-		com->autofill_values=get_autofill_cells(&game->board);
-		changed=autofill_board(&game->board,com->autofill_values,FIRST_TIME);
-		if(!changed){
-			free_command(com);
-			print_board(&game->board,game->state == solve,game->mark_errors);
-			return;
-		}
-		push(&game->undo_stack,com);
-		print_board(&game->board,game->state == solve,game->mark_errors);
-		if(!game->board.empty_cells && !game->board.errors){
-			printf("Puzzle solved successfully\n");
-			free_game_data(game);
-			game->state=init;
-			}
-		empty_stack(&game->redo_stack);
+		/*For the deeper levels the board is filled during the search, autofill_board only records and prints the changes*/
+		if(com->args[0]==AUTOFILL_FIXPOINT)
+			changed=autofill_board(game,autofill_to_fixpoint(&game->board));
+		else if(com->args[0]==AUTOFILL_DEDUCE)
+			changed=autofill_board(game,autofill_deduce(&game->board));
+		else
+			changed=autofill_board(game,get_autofill_cells(&game->board));
+		show_board(game);
+		if(changed && !game->board.empty_cells && !game->board.errors)
+			end_solved_game(game);
 	}else{
-		printf("Error: board contains erroneous values\n");
-		free_command(com);
+		fprintf(game->out,"Error: board contains erroneous values\n");
 	}
 }
 
-void execute_num_solutions(game_data *game, commandInfo *com){
-	int sol_num;
+/*Returns a solution of the board in the same way find_solution does, from the cache if it keeps one
+ * A solution found by the solver is added to the cache*/
+game_board cached_solution(game_data *game){
+	cache_entry entry;
+	if(game->cache!=NULL && cache_lookup(game->cache,&game->board,&entry)
+			&& (entry.solution.block_rows || entry.solvable==0)) /*No solution is kept for an unsolvable board*/
+		return entry.solution;
+	entry.solution=find_solution(&game->solver,&game->board);
+	if(game->cache!=NULL && entry.solution.block_rows){ /*A failed or cancelled solver also returns no solution*/
+		entry.solutions=CACHE_UNKNOWN;
+		entry.solvable=1;
+		cache_store(game->cache,&game->board,&entry);
+	}
+	return entry.solution;
+}
+
+/*Returns the number of solutions of the board, from the cache if it was counted before*/
+int cached_solution_count(game_data *game){
+	cache_entry entry;
 	game_board temp;
+	if(game->cache!=NULL && cache_lookup(game->cache,&game->board,&entry)){
+		if(entry.solution.block_rows)
+			free_board(&entry.solution);
+		if(entry.solutions!=CACHE_UNKNOWN)
+			return entry.solutions;
+	}
+	temp=create_board(game->board.block_rows,game->board.block_columns);
+	copy_board(&game->board,&temp);
+	fix_all_cells(&temp);
+	entry.solutions=count_solutions(&game->solver,&temp);
+	free_board(&temp);
+	if(game->cache!=NULL && !game->solver.aborted){ /*A cancelled count is partial*/
+		entry.solvable=CACHE_UNKNOWN;
+		entry.solution.block_rows=0;
+		entry.solution.block_columns=0;
+		cache_store(game->cache,&game->board,&entry);
+	}
+	return entry.solutions;
+}
+
+void execute_num_solutions(game_data *game){
+	int sol_num;
 	if(game->board.errors){
-		printf("Error: board contains erroneous values\n");
+		fprintf(game->out,"Error: board contains erroneous values\n");
 	}
 	else{
-		temp=create_board(game->board.block_rows,game->board.block_columns);
-		copy_board(&game->board,&temp);
-		fix_all_cells(&temp);
-		sol_num=count_solutions(&temp);
-		printf("Number of solutions: %d\n",sol_num);
+		sol_num=cached_solution_count(game);
+		fprintf(game->out,"Number of solutions: %d\n",sol_num);
 		if(sol_num==1)
-			printf("This is a good board!\n");
+			fprintf(game->out,"This is a good board!\n");
 		else if(sol_num!=0)
-			printf("The puzzle has more than 1 solution, try to edit it further\n");
-		free_board(&temp);
+			fprintf(game->out,"The puzzle has more than 1 solution, try to edit it further\n");
 	}
-	free_command(com);
 }
 
-void execute_exit(game_data *game, commandInfo *com){
-	printf("Exiting...\n");
+void execute_exit(game_data *game){
+	fprintf(game->out,"Exiting...\n");
 	free_game_data(game);
-	free_command(com);
+	if(game->session){ /*Only the session ends, the server keeps running*/
+		game->state=init;
+		game->exited=1;
+		return;
+	}
+	if(game->pool!=NULL)
+		free_pool(game->pool);
+	if(game->cache!=NULL)
+		close_cache(game->cache);
+	if(game->saves!=NULL)
+		free_save_queue(game->saves);
+	if(game->screen!=NULL)
+		close_screen(game->screen);
 	exit(0);
 }
 
-void execute_invalid(commandInfo *com){
-	printf("ERROR: invalid command\n");
-	free_command(com);
+void execute_invalid(game_data *game){
+	fprintf(game->out,"ERROR: invalid command\n");
 }
 
 void execute_save(game_data *game,commandInfo *com){
 	game_board sol;
-	if(game->state == edit && game->board.errors){
-		printf("Error: board contains erroneous values\n");
-		free_command(com);
+	if(game->state == edit){ /*Only an edited board has to be valid and solvable to be saved*/
+		if(game->board.errors){
+			fprintf(game->out,"Error: board contains erroneous values\n");
+			return;
+		}
+		sol=find_solution(&game->solver,&game->board);
+		if(UNSOLVABLE){
+			fprintf(game->out,"Error: board validation failed\n");
+			return;
+		}
+		free_board(&sol);
+	}
+	if(game->saves!=NULL){ /*The I/O thread writes a copy, the result is reported at the next prompt*/
+		if(game->state == edit)
+			fix_all_cells(&game->board); /*As save_board does to the board it saves*/
+		queue_save(game->saves,&game->board,com->tokens[0],game->state == edit,game->atomic_save);
+		fprintf(game->out,"Saving to: %s\n",com->tokens[0]);
 		return;
 	}
-	sol=find_solution(&game->board);
-	if(game-> state == edit && UNSOLVABLE){
-		printf("Error: board validation failed\n");
+	if(save_board(&game->board,com->tokens[0],game->state == edit,game->atomic_save)){
+		fprintf(game->out,"Saved to: %s\n",com->tokens[0]);
+		start_journal(game,com->tokens[0],1); /*The saved file holds all the changes so far*/
 	}else{
-		if(save_board(&game->board,com->tokens[0],game->state == edit)){
-			printf("Saved to: %s\n",com->tokens[0]);
-		}else{
-			printf("Error: File cannot be created or modified\n");
+		fprintf(game->out,"Error: File cannot be created or modified\n");
+	}
+}
+
+/*Brings the board to the state of replayed as a single move, so the changes restored from a journal
+ * can be undone and the reset command goes back to the board of the file*/
+void record_replay(game_data *game, game_board *replayed){
+	int x,y,len;
+	len=board_len(&game->board);
+	begin_move(&game->hist,MOVE_MULTI);
+	for(x=0;x<len;x++){
+		for(y=0;y<len;y++){
+			if(replayed->cells[x][y].value!=game->board.cells[x][y].value
+					|| replayed->cells[x][y].is_fixed!=game->board.cells[x][y].is_fixed){
+				record_set(game,x,y,replayed->cells[x][y].value);
+				game->board.cells[x][y].is_fixed=replayed->cells[x][y].is_fixed;
+				game->hist.deltas[game->hist.count-1].new_fixed=replayed->cells[x][y].is_fixed;
+			}
 		}
 	}
-	if(!UNSOLVABLE){
-		free_board(&sol);
+	finish_move(game);
+}
+
+/*Replaces the current game with a new one on the given board, loaded from path (NULL if none)
+ * A copy of the board is kept so the reset command can return to it at once
+ * If the file has a journal, the changes in it are replayed on top of the board as the first move*/
+void start_game(game_data *game, game_board board, game_state state, char *path){
+	game_board replayed;
+	int restored;
+	free_game_data(game);
+	game->board = board;
+	game->initial = create_board(board.block_rows,board.block_columns);
+	copy_board(&game->board,&game->initial);
+	game->versions = create_versions(&game->board);
+	game->version = 0;
+	game->state = state;
+	if(path!=NULL && game->journal_fsync!=JOURNAL_OFF){
+		replayed = create_board(board.block_rows,board.block_columns);
+		copy_board(&game->board,&replayed);
+		restored=replay_journal(path,&replayed);
+		if(restored){
+			record_replay(game,&replayed); /*Before the journal is opened, the changes are in it already*/
+			fprintf(game->out,"Restored %d changes from the journal\n",restored);
+		}
+		free_board(&replayed);
+		start_journal(game,path,0);
+	}
+}
+
+/*Loads the board the solve and edit commands name: the board of the file in tokens[0], or for a file
+ * in the binary format or an archive, board number tokens[1] of it (0 if not given)
+ * Puts in *journal_path the path the journal of the board is kept for, NULL for a board picked out of a
+ * binary file by its number*/
+game_board load_command_board(commandInfo *com, char **journal_path){
+	*journal_path=com->tokens[0];
+	if((is_binary_path(com->tokens[0]) || is_archive_path(com->tokens[0])) && com->tokens[1]!=NULL){
+		*journal_path=NULL;
+		return load_board_at(com->tokens[0],string_to_int(com->tokens[1]));
 	}
-	free_command(com);
+	return load_board(com->tokens[0]);
 }
 
 void execute_solve(game_data *game,commandInfo *com){
-	game_board board = load_board(com->tokens[0]);
+	char *journal_path;
+	game_board board = load_command_board(com,&journal_path);
 	if(board.block_columns == 0){
-		printf("Error: File doesn't exist or cannot be opened\n");
+		fprintf(game->out,"Error: File doesn't exist or cannot be opened\n");
 	}else{
-		free_game_data(game);
-		game->board = board;
-		game->state = solve;
-		print_board(&game->board,1,game->mark_errors);
+		start_game(game,board,solve,journal_path);
+		show_board(game);
 	}
-	free_command(com);
 }
 
 void execute_edit(game_data *game, commandInfo *com){
 	game_board board;
+	char *journal_path=NULL;
 	if(com->tokens[0] != NULL){
-		board = load_board(com->tokens[0]);
+		board = load_command_board(com,&journal_path);
 	}else{
 		board = create_board(DEFAULT_SIZE,DEFAULT_SIZE);
 	}
 	if(board.block_columns == 0){
-		printf("Error: File cannot be opened\n");
+		fprintf(game->out,"Error: File cannot be opened\n");
 	}else{
-		free_game_data(game);
-		game->board = board;
-		game->state = edit;
-		print_board(&game->board,0,game->mark_errors);
+		start_game(game,board,edit,journal_path);
+		show_board(game);
 	}
-	free_command(com);
 }
 
 void execute_hint(game_data *game, commandInfo *com)
 {
 	game_board sol;
 	if(!RANGE(com->args[0]) || !RANGE(com->args[1]))
-		printf("Error: value not in range 1-%d\n",board_len(&game->board));
+		fprintf(game->out,"Error: value not in range 1-%d\n",board_len(&game->board));
 	else if(game->board.errors)
-		printf("Error: board contains erroneous values\n");
+		fprintf(game->out,"Error: board contains erroneous values\n");
 	else if(game->board.cells[com->args[0]][com->args[1]].is_fixed)
-		printf("Error: cell is fixed\n");
+		fprintf(game->out,"Error: cell is fixed\n");
 	else if(game->board.cells[com->args[0]][com->args[1]].value)
-		printf("Error: cell already contains a value\n");
+		fprintf(game->out,"Error: cell already contains a value\n");
 	else
 	{
-		sol=find_solution(&game->board);
+		sol=cached_solution(game);
 		if(UNSOLVABLE)
-			printf("Error: board is unsolvable\n");
+			fprintf(game->out,"Error: board is unsolvable\n");
 		else{
-			printf("Hint: set cell to %d\n",sol.cells[com->args[0]][com->args[1]].value);
+			fprintf(game->out,"Hint: set cell to %d\n",sol.cells[com->args[0]][com->args[1]].value);
 			free_board(&sol);
 		}
 	}
-	free_command(com);
 
 }
 
 
 
-void execute_validate(game_data *game, commandInfo *com)
+/*Returns 1 if the board is solvable in the same way is_solvable does, from the cache if it knows*/
+char cached_is_solvable(game_data *game){
+	cache_entry entry;
+	char solvable;
+	if(game->cache!=NULL && cache_lookup(game->cache,&game->board,&entry)){
+		if(entry.solution.block_rows)
+			free_board(&entry.solution);
+		if(entry.solvable!=CACHE_UNKNOWN)
+			return (char)entry.solvable;
+	}
+	solvable=is_solvable(&game->solver,&game->board);
+	if(game->cache!=NULL && solvable){ /*Only an exhaustive count is trusted to show a board is unsolvable*/
+		entry.solutions=CACHE_UNKNOWN;
+		entry.solvable=1;
+		entry.solution.block_rows=0;
+		entry.solution.block_columns=0;
+		cache_store(game->cache,&game->board,&entry);
+	}
+	return solvable;
+}
+
+void execute_validate(game_data *game)
 {
 	if(game->board.errors)
-		printf("Error: board contains erroneous values\n");
+		fprintf(game->out,"Error: board contains erroneous values\n");
 	else
 	{
-		if(!is_solvable(&game->board))
-			printf("Validation failed: board is unsolvable\n");
+		if(!cached_is_solvable(game))
+			fprintf(game->out,"Validation failed: board is unsolvable\n");
 		else
-			printf("Validation passed: board is solvable\n");
+			fprintf(game->out,"Validation passed: board is solvable\n");
 	}
-	free_command(com);
-}
-
-/*Performs the initial generation of X random values
- * as part of the generate function. Returns the board with the
- * generated values*/
-game_board initial_generation(game_board *board, int x)
-{
-	game_board sol;
-	int attempts=0,selected_cells,*valid_values,row,col,cnt;
-			do{
-				for(selected_cells=0;selected_cells<x;) /*While less than X cells have been selected*/
-				{
-					/*Choose a random cell*/
-					row=rand()%board_len(board);
-					col=rand()%board_len(board);
-					if(!board->cells[col][row].value) /*If the cell is empty*/
-					{
-						/*Get the valid values and count how many there are*/
-						valid_values=get_valid_values(board,col,row);
-						cnt=0;
-						while(valid_values[cnt])
-							cnt++;
-						if(cnt){ /*If there's at least one valid value*/
-							/*Assign a random valid value, increment selected cells and continue*/
-							set_cell(board,col,row,valid_values[rand()%cnt]);
-							free(valid_values);
-							selected_cells++;
-						}
-						else{ /*If there are no valid values for a cell, the board is unsolvable, so no point in continuing*/
-							free(valid_values);
-							break;
-						}
-					}
-				}
-				/*Try solving the board the random board*/
-				sol=find_solution(board);
-				if(UNSOLVABLE)
-				{
-					clear_non_fixed(board); /*Empties the board, since no cells are fixed at this point*/
-					attempts++;
-				}
-				else /*If solvable, we are done*/
-					break;
-			}
-			while(attempts<MAX_GENERATE_ATTEMPTS);
-			return sol;
 }
 
-/*Second phase of the generation, gets a solved board (sol),
- * fixes Y random cells, copies it to the playing board (board) and
- * frees the solution*/
-void second_generation(game_board *board, game_board *sol, int y)
-{
-	fix_random_cells(sol,y);
-	clear_non_fixed(sol);
-	copy_board(sol,board);
-	free_board(sol);
-}
-
-/*Creates a 2d array of the generated fixed values so the
- * generate command can be undone/redone, similarly to the autofill command*/
-int** get_generate_values(game_board *board,int y){
-	int **curr,**autofill_values,i,j;
-	autofill_values=(int**)malloc(sizeof(int*)*(y+1));
-	curr=autofill_values;
-	for(i=0;i<board_len(board);i++){
-		for(j=0;j<board_len(board);j++){
-			if(board->cells[i][j].is_fixed){
-				(*curr)=(int*)malloc(sizeof(int)*3);
-				(*curr)[0]=i;
-				(*curr)[1]=j;
-				(*curr)[2]=board->cells[i][j].value;
-				curr++;
+/*Records the generated fixed values as a single move, so the generate command
+ * can be undone/redone similarly to the autofill command*/
+void record_generate(game_data *game){
+	int x,y,len;
+	len=board_len(&game->board);
+	begin_move(&game->hist,MOVE_MULTI);
+	for(x=0;x<len;x++){
+		for(y=0;y<len;y++){
+			if(game->board.cells[x][y].is_fixed){
+				record_delta(&game->hist,y*len+x,0,game->board.cells[x][y].value,0,1);
+				journal_board_cell(game,x,y);
 			}
 		}
 	}
-	*curr=NULL;
-	return autofill_values;
+	finish_move(game);
 }
 
 void execute_generate(game_data *game, commandInfo *com)
 {
 	int x,y,board_size;
-	int **autofill_values;
-	game_board sol;
 
 	x=com->args[0];
 	y=com->args[1];
 	board_size=board_len(&game->board)*board_len(&game->board);
 
 	if(!(x>=0 && x<=board_size) || !(y>=0 && y<=board_size))
-		printf("Error: value not in range 0-%d\n",board_size);
+		fprintf(game->out,"Error: value not in range 0-%d\n",board_size);
 	else if(game->board.empty_cells!=board_size)
-		printf("Error: board is not empty \n");
+		fprintf(game->out,"Error: board is not empty \n");
 	else
 	{
-		/*First phase of generation, filling X random cells*/
-		sol=initial_generation(&game->board,x);
-		if(UNSOLVABLE){
-			printf("Error: puzzle generator failed\n");
-			free_command(com);
+		/*Taking a ready puzzle from the pool if there is one, otherwise
+		 * filling X random cells, solving and clearing all but Y cells*/
+		if(!pool_take(game->pool,&game->board,x,y) && !generate_puzzle(&game->solver,&game->board,x,y,0)){
+			fprintf(game->out,"Error: puzzle generator failed\n");
 		}
 		else
 		{
-			/*Second phase of generation, clearing all but Y cells*/
-			second_generation(&game->board,&sol,y);
-			print_board(&game->board,game->state == solve,game->mark_errors);
-			/*Gathering info for undo/redo and changing stacks accordingly*/
-			autofill_values=get_generate_values(&game->board,y);
-			com->autofill_values=autofill_values;
-			push(&game->undo_stack,com);
-			empty_stack(&game->redo_stack);
+			show_board(game);
+			record_generate(game);
 		}
 	}
 }
 
+void execute_status(game_data *game){
+	if(game->job==NULL)
+		fprintf(game->out,"No command is running\n");
+	else
+		print_job_status(game);
+}
+
+void execute_cancel(game_data *game){
+	if(game->job==NULL){
+		fprintf(game->out,"Error: no command is running\n");
+	}else{
+		cancel_job(game);
+		fprintf(game->out,"Cancelling the running command\n");
+	}
+}
+
+/*Returns 1 if the command may run long enough to keep the user (or the other sessions of the server) waiting*/
+char is_heavy_command(func_name name){
+	return name==hint || name==validate || name==num_solutions || name==generate || name==save;
+}
+
+/*Returns 1 if the command should run as a job of the console (see job.h)
+ * A save in solve mode only hands a copy of the board to the I/O thread, so it runs at once*/
+char runs_as_job(game_data *game, func_name name){
+	if(name==save && game->saves!=NULL && game->state!=edit)
+		return 0;
+	return game->background && is_heavy_command(name);
+}
+
 void execute(game_data *game, commandInfo *com)
 {
 	if(!check_mode_compatibility(game,com->commandName))
 		com->commandName=invalid;
+	if(game->job!=NULL)
+		collect_job(game);
+	if(game->job!=NULL && com->commandName==ex)
+		stop_job(game); /*The running command is dropped, its changes are kept if it finished*/
+	if(game->job!=NULL){
+		if(!job_allows(game,com->commandName)){
+			fprintf(game->out,"Error: a command is running in the background, use status to follow it or cancel to stop it\n");
+			return;
+		}
+		hold_job_output(game);
+	}else if(runs_as_job(game,com->commandName)){
+		start_job(game,com);
+		return;
+	}
 	switch(com->commandName){
 			case set:
 				execute_set(game,com);
@@ -532,7 +833,7 @@ void execute(game_data *game, commandInfo *com)
 				break;
 
 			case validate:
-				execute_validate(game,com);
+				execute_validate(game);
 				break;
 
 			case undo:
@@ -540,11 +841,23 @@ void execute(game_data *game, commandInfo *com)
 				break;
 
 			case redo:
-				execute_redo(game,com);
+				execute_redo(game);
+				break;
+
+			case goto_move:
+				execute_goto_move(game,com);
+				break;
+
+			case checkout:
+				execute_checkout(game,com);
+				break;
+
+			case list_versions:
+				execute_versions(game);
 				break;
 
 			case reset:
-				execute_reset(game,com);
+				execute_reset(game);
 				break;
 
 			case m_errors:
@@ -552,7 +865,7 @@ void execute(game_data *game, commandInfo *com)
 				break;
 
 			case p_board:
-				execute_print_board(game,com);
+				execute_print_board(game);
 				break;
 
 			case autofill:
@@ -560,15 +873,15 @@ void execute(game_data *game, commandInfo *com)
 				break;
 
 			case num_solutions:
-				execute_num_solutions(game,com);
+				execute_num_solutions(game);
 				break;
 
 			case ex:
-				execute_exit(game,com);
+				execute_exit(game);
 				break;
 
 			case invalid:
-				execute_invalid(com);
+				execute_invalid(game);
 				break;
 			case solve_command:
 				execute_solve(game,com);
@@ -582,6 +895,20 @@ void execute(game_data *game, commandInfo *com)
 			case generate:
 				execute_generate(game,com);
 				break;
+			case job_status:
+				execute_status(game);
+				break;
+			case job_cancel:
+				execute_cancel(game);
+				break;
 		}
-	fflush(stdout);
+	if(game->job!=NULL){ /*Nothing was changed, and the journal may be in use by the job*/
+		fflush(game->out);
+		release_job_output(game);
+		return;
+	}
+	if(game->journal!=NULL && journal_commit(game->journal))
+		fprintf(game->out,"Error: journal cannot be written, changes are no longer journaled\n");
+	if(!game->quiet)
+		fflush(game->out);
 }
@@ -1,7 +1,13 @@
 /*This module handles the execution of user commands*/
 
+#ifndef _EXECUTERH_
+#define _EXECUTERH_
 
 #include "board.h"
+#include "parser.h"
+#include "history.h"
+#include "versions.h"
+#include "solver_context.h"
 
 /*An enum for the game states*/
 typedef enum game_state
@@ -12,11 +18,44 @@ typedef enum game_state
 /*A struct that keeps all the relevant data for a game session*/
 typedef struct game_data{
 	game_board board;
-	Stack undo_stack,redo_stack;
+	game_board initial; /*The board as it was loaded, for the reset command*/
+	history hist; /*The moves that can be undone and redone*/
+	version_store versions; /*Every version the board had in the current game*/
+	int version; /*The version of the current board*/
 	char mark_errors;
+	solver_context solver; /*Counters, random numbers and scratch memory of the solver calls of the game*/
+	FILE *out; /*Where the output of the commands goes*/
+	char session; /*Set when the game is a session of the server, where exit ends only the session*/
+	char exited; /*Set once the exit command ended the session*/
+	char quiet; /*Set in script mode: the board is printed only by the print_board command*/
 	game_state state;
+	char atomic_save; /*Set when save replaces the file atomically (see save_board)*/
+	int journal_fsync; /*fsync policy of the journals, JOURNAL_OFF if they are not kept (see journal.h)*/
+	struct journal *journal; /*Journal of the current game, NULL if none*/
+	struct solution_cache *cache; /*What the solvers found out in this and earlier runs, NULL if not used*/
+	struct puzzle_pool *pool; /*Pre-generated puzzles for the generate command, NULL if not used*/
+	char background; /*Set on an interactive console: heavy commands run in the background (see job.h)*/
+	struct job *job; /*The command running in the background, NULL if none*/
+	struct save_queue *saves; /*Writes the saved boards in the background, NULL if save writes them at once*/
+	struct screen *screen; /*Keeps the board pinned to the top of the terminal, NULL if it's printed after every change*/
 
 }game_data;
 
+/*Frees the board, versions and journal of the current game, the history is kept for the next one*/
+void free_game_data(game_data *game);
+
+/*Returns 1 if the command may run long enough to keep the user (or the other sessions of the server) waiting*/
+char is_heavy_command(func_name name);
+
+/*Reports the saves that were written in the background since it was last called, called before every prompt
+ * A save that is done becomes the file the journal of the game is kept for*/
+void report_saves(game_data *game);
+
+/*Brings the board pinned to the top of the terminal up to date with changes that were not shown yet
+ * (made by a background job, or to the error marks), and unpins it when no game is played. Called before every prompt*/
+void update_screen(game_data *game);
+
 /*Executes the given command on the given game data*/
 void execute(game_data *game, commandInfo *com);
+
+#endif
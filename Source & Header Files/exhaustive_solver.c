@@ -5,7 +5,7 @@
 #include <stdio.h>
 
 #include "board.h"
-#include "stack_tools.h"
+#include "solver_context.h"
 #include "error_handler.h"
 
 /*A struct required for the exhaustive backtracking algorithm
@@ -32,44 +32,66 @@ int next_y(game_board *board,int x,int y){
 	return y;
 }
 
-int optionsCnt; /*Stores the number of possible solutions*/
+/*Empties the recursion stack after the search was stopped early,
+ * setting every cell that was filled during the search back to empty*/
+void unwind_recursion(game_board *board, recursion_info *steps, int depth){
+	while(depth>0){
+		depth--;
+		set_cell(board,steps[depth].x,steps[depth].y,0);
+		free(steps[depth].valid_values);
+	}
+}
+
+/*Empties the recursion stack after a solution was found, keeping the values of the cells*/
+void drop_recursion(recursion_info *steps, int depth){
+	while(depth>0)
+		free(steps[--depth].valid_values);
+}
 
 /*
  * The exhaustive backtracking algorithm itself
  * Each step is explained inside the code
+ * The recursion stack is an array in the scratch memory of the context, a cell never has more than one step in it
+ * If keep is set, the board is left with the last solution found when the limit is reached
  */
-void exhaustive_solve(game_board *board){
+void exhaustive_solve(solver_context *ctx, game_board *board, char keep){
 	int *valid_values=NULL; /*An array for the valid values of a cell*/
 	int i=0; /*Currently examined valid value's index*/
 	int cur_x=0,cur_y=0; /*Currently examined cell coordinates*/
-	Stack rec_stack; /*A stack with the info of the recursion steps*/
-	recursion_info *rec_info; /*Each step's info is kept here*/
+	recursion_info *steps; /*The info of the recursion steps*/
+	int depth=0; /*Number of steps in the stack*/
 
-	rec_stack=create_stack();
+	steps=(recursion_info*)context_scratch(ctx,sizeof(recursion_info)*board_len(board)*board_len(board));
 
 	rec_start:
 	if(cur_y==board_len(board)){ /*We reached a cell out of the board, thus all previous cells are filled with legal values*/
-		++optionsCnt; /*Increment option count*/
+		++ctx->solutions; /*Increment option count*/
+		if(ctx->limit && ctx->solutions>=ctx->limit){ /*Found enough solutions, no point in continuing*/
+			if(keep)
+				drop_recursion(steps,depth);
+			else
+				unwind_recursion(board,steps,depth);
+			return;
+		}
 
-		/*Extract info about the previous recursion step and copy it to the current step info*/
-		rec_info=(recursion_info*)pop(&rec_stack);
-		if(rec_info==NULL)
+		/*Extract info about the previous recursion step*/
+		if(depth==0)
 			return;
-		cur_x=rec_info->x;
-		cur_y=rec_info->y;
-		valid_values=rec_info->valid_values;
-		i=rec_info->count;
+		depth--;
+		cur_x=steps[depth].x;
+		cur_y=steps[depth].y;
+		valid_values=steps[depth].valid_values;
+		i=steps[depth].count;
 
-		/*Free memory and start where the step we extracted left off*/
-		free(rec_info);
+		/*Start where the step we extracted left off*/
 		goto rec_start;
 	}
 
 	if(board->cells[cur_x][cur_y].is_fixed)
 	{
 		/*Skip fixed cells, no need to handle them or push into stack*/
-		cur_x=next_x(board,cur_x);
 		cur_y=next_y(board,cur_x,cur_y);
+		cur_x=next_x(board,cur_x);
 		i=0;
 		valid_values=NULL;
 		goto rec_start;
@@ -77,6 +99,12 @@ void exhaustive_solve(game_board *board){
 	if(valid_values==NULL){
 	/*Find valid values only if we're dealing with a new recursion step
 	 * A new step is indicated by valid_values==NULL*/
+	 if(ctx->cancelled){ /*All the values in use are in the stack at this point*/
+		 ctx->aborted=1;
+		 unwind_recursion(board,steps,depth);
+		 return;
+	 }
+	 ctx->steps++;
 	 valid_values=get_valid_values(board,cur_x,cur_y);
 	 i=0;
 	}
@@ -87,18 +115,15 @@ void exhaustive_solve(game_board *board){
 		++i;
 
 		/*Save the recursion step info into the stack*/
-		rec_info=(recursion_info*)malloc(sizeof(recursion_info));
-		if(rec_info==NULL)
-			function_error(f_malloc);
-		rec_info->count=i;
-		rec_info->valid_values=valid_values;
-		rec_info->x=cur_x;
-		rec_info->y=cur_y;
-		push(&rec_stack,rec_info);
+		steps[depth].count=i;
+		steps[depth].valid_values=valid_values;
+		steps[depth].x=cur_x;
+		steps[depth].y=cur_y;
+		depth++;
 
 		/*Move on to the next cell*/
-		cur_x=next_x(board,cur_x);
 		cur_y=next_y(board,cur_x,cur_y);
+		cur_x=next_x(board,cur_x);
 		i=0;
 		valid_values=NULL;
 		goto rec_start;
@@ -111,26 +136,41 @@ void exhaustive_solve(game_board *board){
 		set_cell(board,cur_x,cur_y,0);
 
 		/*Go back to the previous recursion step, if there are none we are done*/
-		rec_info=(recursion_info*)pop(&rec_stack);
-		if(rec_info==NULL)
+		if(depth==0)
 			return;
-		cur_x=rec_info->x;
-		cur_y=rec_info->y;
-		i=rec_info->count;
-		valid_values=rec_info->valid_values;
-		free(rec_info);
+		depth--;
+		cur_x=steps[depth].x;
+		cur_y=steps[depth].y;
+		i=steps[depth].count;
+		valid_values=steps[depth].valid_values;
 		goto rec_start;
 	}
 
 
 }
 
+/*Runs the exhaustive backtracking algorithm on the board, stopping as soon
+ * as limit solutions were found (0 means no limit), and returns the number of solutions found*/
+int count_solutions_up_to(solver_context *ctx, game_board *board, int limit){
+	ctx->solutions = 0;
+	ctx->limit = limit;
+	exhaustive_solve(ctx,board,0);
+	return ctx->solutions;
+}
+
 /*Runs the exhaustive backtracking algorithm on the board and
  * returns the number of solutions*/
-int count_solutions(game_board *board){
-	optionsCnt = 0;
-	exhaustive_solve(board);
-	return optionsCnt;
+int count_solutions(solver_context *ctx, game_board *board){
+	return count_solutions_up_to(ctx,board,0);
 }
 
-
+/*Fills the empty cells of the board with the first solution the search finds
+ * Returns 1 if a solution was found, otherwise returns 0 and the board is left as it was*/
+char solve_in_place(solver_context *ctx, game_board *board){
+	if(board->errors)
+		return 0;
+	ctx->solutions = 0;
+	ctx->limit = 1;
+	exhaustive_solve(ctx,board,1);
+	return ctx->solutions==1;
+}
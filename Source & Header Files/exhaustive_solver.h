@@ -2,8 +2,19 @@
  * for the num_solutions command*/
 
 #include "board.h"
+#include "solver_context.h"
 
 
 /*Runs the exhaustive backtracking algorithm on the board
- * and returns the number of solutions*/
-int count_solutions(game_board *board);
+ * and returns the number of solutions
+ * If ctx->cancelled is set during the search, it stops and returns the solutions found so far*/
+int count_solutions(solver_context *ctx, game_board *board);
+
+/*Same as count_solutions, but stops as soon as limit solutions were found
+ * (0 means no limit). Used to check whether a board has a unique solution*/
+int count_solutions_up_to(solver_context *ctx, game_board *board, int limit);
+
+/*Fills the empty cells of the board with the first solution the backtracking search finds,
+ * assumes the non-empty cells are fixed
+ * Returns 1 if a solution was found, otherwise returns 0 and the board is left as it was*/
+char solve_in_place(solver_context *ctx, game_board *board);
@@ -1,106 +1,347 @@
 /*This module handles all operations involving files, i.e. loading and saving board
  * to and from files*/
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "board.h"
+#include "generator.h"
+#include "binary_format.h"
+#include "archive.h"
+#include "file_operations.h"
 #include "error_handler.h"
 
-#define DELIM " \t\r\n"
+#define TEMP_SUFFIX ".tmp"
+#define FILE_MODE 0666 /*Same as fopen, the umask applies*/
+#define INITIAL_INDEX_CAPACITY 1024
+
+/*Writes the decimal digits of the non-negative number n to buffer
+ * Returns the number of characters written*/
+int format_int(char *buffer, int n){
+	char digits[12]; /*Enough for any int*/
+	int count=0,i;
+	do{
+		digits[count++]=(char)('0'+n%10);
+		n/=10;
+	}while(n);
+	for(i=0;i<count;i++)
+		buffer[i]=digits[count-1-i];
+	return count;
+}
+
+/*Returns the number of bytes format_board may write for the board*/
+size_t board_text_size(game_board *board){
+	size_t len=board_len(board);
+	char digits[12];
+	/*Every cell is a value, possibly a '.', and a space; every row ends with a newline*/
+	return 2*sizeof(digits)+2+len*len*(format_int(digits,(int)len)+2)+len;
+}
+
+/*Writes the board to buffer in the format described in the project file, buffer holds
+ * board_text_size(board) bytes. Returns the number of bytes written*/
+size_t format_board(game_board *board, char *buffer){
+	int x,y,len;
+	game_cell *cell;
+	char *p=buffer;
+	len=board_len(board);
+	p+=format_int(p,board->block_rows);
+	*p++=' ';
+	p+=format_int(p,board->block_columns);
+	*p++='\n';
+	for(y = 0; y < len;++y){
+		for(x = 0; x < len;++x){
+			cell=&board->cells[x][y];
+			p+=format_int(p,cell->value);
+			if(cell->is_fixed)
+				*p++='.';
+			*p++=' ';
+		}
+		*p++='\n';
+	}
+	return p-buffer;
+}
+
+/*Writes the board to the given stream in the same format save_board uses
+ * Assumes outFile is open for writing*/
+void write_board(game_board *board,FILE *outFile){
+	char *buffer;
+	size_t size;
+	buffer=(char*)malloc(board_text_size(board));
+	if(buffer==NULL) function_error(f_malloc);
+	size=format_board(board,buffer);
+	if(fwrite(buffer,1,size,outFile)!=size) function_error(f_fprintf);
+	free(buffer);
+}
 
-/*Saves the board to the given path
+/*Returns a container in the binary format holding only the board, its size is put in *size
+ * Assumes the blocks of the board aren't too large for the format*/
+unsigned char *binary_image(game_board *board, size_t *size){
+	unsigned char *image;
+	size_t record=binary_record_size(board);
+	*size=BINARY_HEADER_SIZE+record+BINARY_OFFSET_SIZE;
+	image=(unsigned char*)malloc(*size);
+	if(image==NULL) function_error(f_malloc);
+	encode_binary_header(image,1,BINARY_HEADER_SIZE+record);
+	encode_board(board,image+BINARY_HEADER_SIZE);
+	encode_offset(image+BINARY_HEADER_SIZE+record,BINARY_HEADER_SIZE);
+	return image;
+}
+
+/*Saves the board to the given path, in the binary format or as an archive if the path has their extension
  * Return 1 on a successful save, otherwise returns 0
  * fix_cells parameter indicates whether all non-empty cells of the board
- * should be fixed when saved, i.e. if we're saving in edit mode*/
-char save_board(game_board *board,char* path,char fix_cells){
-	int x,y;
-	FILE* outFile;
-	outFile = fopen(path,"w");
-	if(outFile == NULL){
+ * should be fixed when saved, i.e. if we're saving in edit mode
+ * The whole file is formatted in memory and written at once. If atomic is set, it is written
+ * to <path>.tmp and renamed over path once it is on the disk, so path always holds a complete board*/
+char save_board(game_board *board,char* path,char fix_cells,char atomic){
+	char *buffer,*target,binary,archive;
+	size_t size;
+	int fd;
+	char ok;
+	binary=is_binary_path(path);
+	archive=is_archive_path(path);
+	if((binary || archive) && !binary_record_size(board))
+		return 0; /*The blocks are too large for the binary format*/
+	target=path;
+	if(atomic){
+		target=(char*)malloc(strlen(path)+sizeof(TEMP_SUFFIX));
+		if(target==NULL) function_error(f_malloc);
+		strcpy(target,path);
+		strcat(target,TEMP_SUFFIX);
+	}
+	fd = open(target,O_WRONLY|O_CREAT|O_TRUNC,FILE_MODE);
+	if(fd < 0){
+		if(atomic) free(target);
 		return 0; /*Not function_error according to the project description*/
 	}
 	if(fix_cells){
 		fix_all_cells(board);
 	}
-	fprintf(outFile,"%d %d\n",board->block_rows,board->block_columns);
-	if(ferror(outFile)) function_error(f_fprintf);
-	for(y = 0; y < board_len(board);++y){
-		for(x = 0; x < board_len(board);++x){
-			fprintf(outFile,"%d",board->cells[x][y].value);
-			if(ferror(outFile)) function_error(f_fprintf);
-			if(board->cells[x][y].is_fixed){
-				fprintf(outFile,".");
-				if(ferror(outFile)) function_error(f_fprintf);
-			}
-			fprintf(outFile," ");
-			if(ferror(outFile)) function_error(f_fprintf);
-		}
-		fprintf(outFile,"\n");
+	if(binary){
+		buffer=(char*)binary_image(board,&size);
+	}else if(archive){
+		buffer=(char*)archive_image(board,&size);
+	}else{
+		buffer=(char*)malloc(board_text_size(board));
+		if(buffer==NULL) function_error(f_malloc);
+		size=format_board(board,buffer);
 	}
-	fclose(outFile);
-	return 1;
+	ok=write_all(fd,buffer,size);
+	if(atomic && ok)
+		ok=!fsync(fd);
+	if(close(fd))
+		ok=0;
+	free(buffer);
+	if(atomic){
+		if(ok)
+			ok=!rename(target,path);
+		if(!ok)
+			unlink(target);
+		free(target);
+	}
+	return ok;
 }
 
-/*Returns the size of the file, and moves the pointer to it's start*/
-long file_size(FILE* file){
-	long sz;
-	if(fseek(file,0,SEEK_END)) function_error(f_fseek);
-	if((sz = ftell(file)) == -1L) function_error(f_ftell);
-	if(fseek(file,0,SEEK_SET)) function_error(f_fseek);
-	return sz;
+/*Returns 1 if c separates the tokens of a board file*/
+char is_file_delim(char c){
+	return c==' ' || c=='\t' || c=='\r' || c=='\n';
 }
 
-/*Returns a string containing the text in the file
- * Assumes inFile is an existing file pointer open in write mode*/
-char* get_contents(FILE* inFile){
-	int file_sz;
-	char *fileContents;
-	file_sz = file_size(inFile);
-	fileContents = (char*)calloc(file_sz+1,sizeof(char));
-	if(fileContents == NULL) function_error(f_calloc);
-	fread(fileContents,1,file_sz+1,inFile);
-	if(ferror(inFile)) function_error(f_fread);
-	return fileContents;
+/*Reads the next token of the text between *pos and end and moves *pos past it
+ * The value is read like atoi does, a token ending with '.' is a fixed cell
+ * Values above limit are all read as limit+1, so they can't overflow
+ * Returns 0 if there are no more tokens*/
+char next_token(char **pos, char *end, int limit, int *value, char *fixed){
+	char *p=*pos;
+	int v=0,sign=1;
+	while(p<end && is_file_delim(*p))
+		p++;
+	if(p==end)
+		return 0;
+	if(*p=='-' || *p=='+'){
+		sign=(*p=='-')?-1:1;
+		p++;
+	}
+	while(p<end && *p>='0' && *p<='9'){
+		if(v<=limit)
+			v=v*10+(*p-'0');
+		p++;
+	}
+	while(p<end && !is_file_delim(*p))
+		p++;
+	*value=sign*(v>limit?limit+1:v);
+	*fixed=(p[-1]=='.');
+	*pos=p;
+	return 1;
 }
 
-/*Loads a board from the given path
- * Returns a 0x0 board if the loading has failed*/
-game_board load_board(char* path){
-	int cell_num,block_rows,block_columns,len,x,y;
-	FILE* inFile;
-	char* fileContents,*tok;
+/*Reads the cells of a board with the given block dimensions from the tokens between pos and end, row by row,
+ * the board is built from them at once
+ * Returns a 0x0 board if the board is longer than MAX_BOARD_LEN, a value is out of range
+ * or there are more tokens than cells*/
+game_board read_cells(int block_rows, int block_columns, char *pos, char *end){
 	game_board board;
+	int cell_num=0,len,value,*values;
+	char fixed,*fixed_cells,valid=1;
+	board.block_columns = 0;
+	board.block_rows = 0;
+	if((size_t)block_rows*block_columns>MAX_BOARD_LEN)
+		return board;
+	len=block_rows*block_columns;
+	values=(int*)calloc((size_t)len*len,sizeof(int));
+	fixed_cells=(char*)calloc((size_t)len*len,sizeof(char));
+	if(values==NULL || fixed_cells==NULL) function_error(f_calloc);
+	while(valid && next_token(&pos,end,len,&value,&fixed)){
+		if(cell_num==len*len || value<0 || value>len){
+			valid=0;
+		}else{
+			values[cell_num]=value;
+			fixed_cells[cell_num++]=fixed;
+		}
+	}
+	if(valid)
+		board=board_from_cells(block_rows,block_columns,values,fixed_cells);
+	free(values);
+	free(fixed_cells);
+	return board;
+}
 
-	inFile = fopen(path,"r");
-	if(inFile == NULL){ /*Not function_error*/
-		board.block_columns = 0;
-		board.block_rows = 0;
+/*Loads a board from the given text file
+ * The file is mapped to memory and scanned once, the cells are written directly
+ * Returns a 0x0 board if the loading has failed, also when the file isn't a valid board*/
+game_board load_text_board(char* path){
+	int fd,block_rows,block_columns;
+	struct stat st;
+	char *contents,*pos,*end,fixed;
+	game_board board;
+
+	board.block_columns = 0;
+	board.block_rows = 0;
+	fd = open(path,O_RDONLY);
+	if(fd < 0) /*Not function_error*/
+		return board;
+	if(fstat(fd,&st) || !S_ISREG(st.st_mode) || st.st_size == 0){
+		close(fd);
 		return board;
 	}
+	contents = (char*)mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(contents == MAP_FAILED) function_error(f_mmap);
+	pos = contents;
+	end = contents+st.st_size;
 
-	fileContents = get_contents(inFile);
-	tok = strtok(fileContents,DELIM);
 	/*Getting board dimensions*/
-	block_rows = atoi(tok);
-	tok = strtok(NULL,DELIM);
-	block_columns = atoi(tok);
-	board = create_board(block_rows,block_columns);
-	tok = strtok(NULL,DELIM);
-	cell_num = 0;
-
-	while(tok != NULL){
-		x = cell_num % board_len(&board);
-		y = cell_num / board_len(&board);
-		len = strlen(tok);
-		set_cell(&board,x,y,atoi(tok));
-		if(tok[len-1] == '.'){ /*Checks whether the cell is fixed*/
-			board.cells[x][y].is_fixed = 1;
-		}
-		tok = strtok(NULL,DELIM);
-		++cell_num;
+	if(next_token(&pos,end,MAX_BOARD_LEN,&block_rows,&fixed) && next_token(&pos,end,MAX_BOARD_LEN,&block_columns,&fixed)
+			&& block_rows > 0 && block_columns > 0){
+		board = read_cells(block_rows,block_columns,pos,end);
 	}
-	fclose(inFile);
-	free(fileContents);
+	munmap(contents,st.st_size);
+	return board;
+}
+
+/*Loads board number index (counting from 0) of the file at path
+ * A text file holds a single board, a binary file any number of them
+ * Returns a 0x0 board if the loading has failed*/
+game_board load_board_at(char* path, long index){
+	game_board board;
+	if(is_binary_path(path))
+		return load_binary_board(path,index);
+	if(is_archive_path(path))
+		return load_archive_board(path,index);
+	if(index==0)
+		return load_text_board(path);
+	board.block_columns = 0;
+	board.block_rows = 0;
 	return board;
 }
+
+/*Loads a board from the given path, the format is chosen by the extension of the path
+ * Returns a 0x0 board if the loading has failed*/
+game_board load_board(char* path){
+	return load_board_at(path,0);
+}
+
+/*Opens a writer of boards to the file at path, in the format chosen by its extension
+ * Returns NULL if the file cannot be created*/
+board_writer *open_board_writer(char *path){
+	board_writer *w;
+	unsigned char header[BINARY_HEADER_SIZE];
+	w=(board_writer*)calloc(1,sizeof(board_writer));
+	if(w==NULL) function_error(f_calloc);
+	w->file=fopen(path,"w");
+	if(w->file==NULL){
+		free(w);
+		return NULL;
+	}
+	if(is_archive_path(path)){
+		w->archive=create_archive_writer(w->file);
+		return w;
+	}
+	w->binary=is_binary_path(path);
+	if(w->binary){
+		encode_binary_header(header,0,0); /*Rewritten once the index is written*/
+		if(fwrite(header,1,BINARY_HEADER_SIZE,w->file)!=BINARY_HEADER_SIZE) function_error(f_fprintf);
+		w->position=BINARY_HEADER_SIZE;
+	}
+	return w;
+}
+
+/*Writes the board after the boards written so far
+ * Returns 0 if the board can't be stored in the format of the file*/
+char add_board(board_writer *w, game_board *board){
+	size_t size;
+	if(w->archive!=NULL)
+		return archive_add(w->archive,board);
+	if(!w->binary){
+		write_board(board,w->file);
+		return 1;
+	}
+	size=binary_record_size(board);
+	if(!size)
+		return 0;
+	if(size>w->record_capacity){
+		free(w->record);
+		w->record=(unsigned char*)malloc(size);
+		if(w->record==NULL) function_error(f_malloc);
+		w->record_capacity=size;
+	}
+	if(w->count==w->capacity){
+		w->capacity=w->capacity?w->capacity*2:INITIAL_INDEX_CAPACITY;
+		w->offsets=(unsigned long*)realloc(w->offsets,sizeof(unsigned long)*w->capacity);
+		if(w->offsets==NULL) function_error(f_malloc);
+	}
+	encode_board(board,w->record);
+	if(fwrite(w->record,1,size,w->file)!=size) function_error(f_fprintf);
+	w->offsets[w->count++]=w->position;
+	w->position+=size;
+	return 1;
+}
+
+/*Finishes the file and frees the writer
+ * A binary file gets its index, and its header is rewritten to point to it*/
+void close_board_writer(board_writer *w){
+	unsigned char entry[BINARY_OFFSET_SIZE],header[BINARY_HEADER_SIZE];
+	unsigned long i;
+	if(w->archive!=NULL)
+		finish_archive(w->archive);
+	if(w->binary){
+		for(i=0;i<w->count;i++){
+			encode_offset(entry,w->offsets[i]);
+			if(fwrite(entry,1,BINARY_OFFSET_SIZE,w->file)!=BINARY_OFFSET_SIZE) function_error(f_fprintf);
+		}
+		encode_binary_header(header,w->count,w->position);
+		if(fseek(w->file,0,SEEK_SET)) function_error(f_fseek);
+		if(fwrite(header,1,BINARY_HEADER_SIZE,w->file)!=BINARY_HEADER_SIZE) function_error(f_fprintf);
+	}
+	if(fclose(w->file)) function_error(f_fprintf);
+	free(w->offsets);
+	free(w->record);
+	free(w);
+}
@@ -1,11 +1,55 @@
 /*This module handles all operations involving files, i.e. loading and saving board
- * to and from files*/
+ * to and from files
+ * Paths with the binary extension (see binary_format.h) are in the binary format, paths with the archive
+ * extension (see archive.h) are compressed archives, any other path is text*/
 
+#ifndef _FILEOPERATIONSH_
+#define _FILEOPERATIONSH_
 
-/*Saves the board to the given path
+#include <stdio.h>
+#include "board.h"
+
+/*A struct that writes boards one after the other to a single file*/
+typedef struct board_writer{
+	FILE *file;
+	char binary; /*Set if the file is in the binary format*/
+	unsigned long *offsets; /*Offsets of the records written so far, for the index of a binary file*/
+	unsigned long count,capacity;
+	unsigned long position; /*Bytes written so far*/
+	unsigned char *record; /*Buffer a binary record is encoded into*/
+	size_t record_capacity;
+	struct archive_writer *archive; /*Set if the file is a compressed archive*/
+} board_writer;
+
+/*Writes the board to the given stream in the same format save_board uses for text files*/
+void write_board(game_board *board,FILE *outFile);
+
+/*Returns the number of bytes format_board may write for the board*/
+size_t board_text_size(game_board *board);
+
+/*Writes the board to buffer in the save_board format, buffer holds board_text_size(board) bytes
+ * Returns the number of bytes written*/
+size_t format_board(game_board *board, char *buffer);
+
+/*Saves the board to the given path, replacing the file atomically if atomic is set
  * Return 1 on a successful save, otherwise returns 0*/
-char save_board(game_board *board,char* path,char fix_cells);
+char save_board(game_board *board,char* path,char fix_cells,char atomic);
 
 /*Loads a board from the given path
  * Returns a 0x0 board if the loading has failed*/
 game_board load_board(char* path);
+
+/*Loads board number index (counting from 0) of the given file, only binary files and archives hold more than one board
+ * Returns a 0x0 board if the loading has failed*/
+game_board load_board_at(char* path, long index);
+
+/*Opens a writer of boards to the given path, returns NULL if the file cannot be created*/
+board_writer *open_board_writer(char *path);
+
+/*Writes the board after the ones written so far, returns 0 if the format can't store it*/
+char add_board(board_writer *w, game_board *board);
+
+/*Finishes the file (a binary file or an archive gets its index) and frees the writer*/
+void close_board_writer(board_writer *w);
+
+#endif
@@ -0,0 +1,220 @@
+/*This module handles the generation of random puzzles, both for the generate command
+ * and for the batch generator, including passing generated boards between processes*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include "board.h"
+#include "solver_context.h"
+#include "generator.h"
+#include "error_handler.h"
+#include "exhaustive_solver.h"
+#include "ILPsolver.h"
+
+#define UNSOLVABLE (!sol.block_rows)
+#define MAX_GENERATE_ATTEMPTS 1000
+#define RECORD_OK 1
+#define RECORD_FAILED 0
+
+/*Performs the initial generation of X random values
+ * as part of the generate function. Returns the board with the
+ * generated values*/
+game_board initial_generation(solver_context *ctx, game_board *board, int x)
+{
+	game_board sol;
+	int attempts=0,selected_cells,*valid_values,row,col,cnt;
+			do{
+				for(selected_cells=0;selected_cells<x;) /*While less than X cells have been selected*/
+				{
+					/*Choose a random cell*/
+					row=random_below(ctx,board_len(board));
+					col=random_below(ctx,board_len(board));
+					if(!board->cells[col][row].value) /*If the cell is empty*/
+					{
+						/*Get the valid values and count how many there are*/
+						valid_values=get_valid_values(board,col,row);
+						cnt=0;
+						while(valid_values[cnt])
+							cnt++;
+						if(cnt){ /*If there's at least one valid value*/
+							/*Assign a random valid value, increment selected cells and continue*/
+							set_cell(board,col,row,valid_values[random_below(ctx,cnt)]);
+							free(valid_values);
+							selected_cells++;
+						}
+						else{ /*If there are no valid values for a cell, the board is unsolvable, so no point in continuing*/
+							free(valid_values);
+							break;
+						}
+					}
+				}
+				/*Try solving the board the random board*/
+				sol=find_solution(ctx,board);
+				if(UNSOLVABLE)
+				{
+					clear_non_fixed(board); /*Empties the board, since no cells are fixed at this point*/
+					attempts++;
+				}
+				else /*If solvable, we are done*/
+					break;
+			}
+			while(attempts<MAX_GENERATE_ATTEMPTS && !ctx->cancelled);
+			return sol;
+}
+
+/*Randomly selects the given amount of cells and sets them to be fixed*/
+void fix_random_cells(solver_context *ctx, game_board *board,int cell_num)
+{
+	int cnt,x,y;
+	for(cnt=0;cnt<cell_num;)
+	{
+		x=random_below(ctx,board_len(board));
+		y=random_below(ctx,board_len(board));
+		if(!board->cells[x][y].is_fixed)
+		{
+			board->cells[x][y].is_fixed=1;
+			cnt++;
+		}
+	}
+}
+
+/*Second phase of the generation, gets a solved board (sol),
+ * fixes Y random cells, copies it to the playing board (board) and
+ * frees the solution*/
+void second_generation(solver_context *ctx, game_board *board, game_board *sol, int y)
+{
+	fix_random_cells(ctx,sol,y);
+	clear_non_fixed(sol);
+	copy_board(sol,board);
+	free_board(sol);
+}
+
+/*Returns 1 if the board has exactly one solution, otherwise returns 0
+ * The search stops after the second solution, so this is much cheaper than count_solutions*/
+char has_unique_solution(solver_context *ctx, game_board *board)
+{
+	game_board temp;
+	int sol_num;
+	temp=create_board(board->block_rows,board->block_columns);
+	copy_board(board,&temp);
+	fix_all_cells(&temp);
+	sol_num=count_solutions_up_to(ctx,&temp,2);
+	free_board(&temp);
+	return sol_num==1;
+}
+
+/*Generates a puzzle with Y fixed cells, starting from X random values
+ * If unique is set, puzzles with more than one solution are thrown away and generated again
+ * Returns 1 on success, otherwise returns 0*/
+char generate_puzzle(solver_context *ctx, game_board *board, int x, int y, char unique)
+{
+	game_board sol;
+	int attempts;
+	for(attempts=0;attempts<MAX_GENERATE_ATTEMPTS && !ctx->cancelled;attempts++){
+		sol=initial_generation(ctx,board,x);
+		if(UNSOLVABLE)
+			break;
+		second_generation(ctx,board,&sol,y);
+		if(!unique || has_unique_solution(ctx,board))
+			return 1;
+		clear_board(board);
+	}
+	if(ctx->cancelled) /*Gave up because of it, not because the puzzle can't be generated*/
+		ctx->aborted=1;
+	return 0;
+}
+
+/*Writes exactly len bytes from buf to fd, retrying on partial writes
+ * Returns 1 on success, 0 if the other side is gone*/
+char write_all(int fd, void *buf, size_t len)
+{
+	char *p=(char*)buf;
+	ssize_t written;
+	while(len){
+		written=write(fd,p,len);
+		if(written<0 && errno==EINTR)
+			continue;
+		if(written<=0)
+			return 0;
+		p+=written;
+		len-=written;
+	}
+	return 1;
+}
+
+/*Reads exactly len bytes from fd into buf, retrying on partial reads
+ * Returns 1 on success, 0 on end of file*/
+char read_all(int fd, void *buf, size_t len)
+{
+	char *p=(char*)buf;
+	ssize_t got;
+	while(len){
+		got=read(fd,p,len);
+		if(got<0 && errno==EINTR)
+			continue;
+		if(got<=0)
+			return 0;
+		p+=got;
+		len-=got;
+	}
+	return 1;
+}
+
+/*A record is a status int followed (on success) by one int per cell,
+ * row by row, holding value*2+is_fixed
+ * The header and the record are written at once, so the reader never sees one without the other*/
+void send_board(int fd, void *header, size_t header_len, game_board *board)
+{
+	int status,*cells,x,y,len;
+	char *buffer;
+	size_t size;
+	status=(board==NULL)?RECORD_FAILED:RECORD_OK;
+	len=(board==NULL)?0:board_len(board);
+	size=header_len+sizeof(int)*(1+(size_t)len*len);
+	buffer=(char*)malloc(size);
+	if(buffer==NULL) function_error(f_malloc);
+	if(header_len>0)
+		memcpy(buffer,header,header_len);
+	memcpy(buffer+header_len,&status,sizeof(int));
+	cells=(int*)(buffer+header_len+sizeof(int));
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++){
+			cells[y*len+x]=board->cells[x][y].value*2+board->cells[x][y].is_fixed;
+		}
+	}
+	write_all(fd,buffer,size);
+	free(buffer);
+}
+
+/*Reads a record written by send_board into board
+ * Returns 1 if a board was read, 0 for a failure record and -1 on end of file*/
+int receive_board(int fd, game_board *board)
+{
+	int status,*cells,i,len;
+	char *fixed;
+	if(!read_all(fd,&status,sizeof(int)))
+		return -1;
+	if(status==RECORD_FAILED)
+		return 0;
+	len=board_len(board);
+	cells=(int*)malloc(sizeof(int)*len*len);
+	fixed=(char*)malloc(len*len);
+	if(cells==NULL || fixed==NULL) function_error(f_malloc);
+	if(!read_all(fd,cells,sizeof(int)*len*len)){
+		free(cells);
+		free(fixed);
+		return -1;
+	}
+	for(i=0;i<len*len;i++){ /*The values are split from the fixed flags in place*/
+		fixed[i]=(char)(cells[i]%2);
+		cells[i]/=2;
+	}
+	set_board_cells(board,cells,fixed);
+	free(cells);
+	free(fixed);
+	return 1;
+}
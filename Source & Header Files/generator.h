@@ -0,0 +1,32 @@
+/*This module handles the generation of random puzzles, both for the generate command
+ * and for the batch generator, including passing generated boards between processes*/
+
+#include <stddef.h>
+#include "board.h"
+#include "solver_context.h"
+
+/*Performs the initial generation of X random values on the given (empty) board
+ * Returns the solution of the generated values, or a 0x0 board if the generation has failed*/
+game_board initial_generation(solver_context *ctx, game_board *board, int x);
+
+/*Fixes Y random cells of the solved board sol, copies them to board and frees sol*/
+void second_generation(solver_context *ctx, game_board *board, game_board *sol, int y);
+
+/*Generates a puzzle with Y fixed cells on the given (empty) board, starting from X random values
+ * If unique is set, only puzzles with a single solution are accepted
+ * The random choices are taken from ctx
+ * Returns 1 on success, otherwise returns 0 and leaves the board empty*/
+char generate_puzzle(solver_context *ctx, game_board *board, int x, int y, char unique);
+
+/*Writes/reads exactly len bytes to/from the file descriptor fd, retrying on partial transfers
+ * Both return 1 on success and 0 if the other side of the pipe is gone*/
+char write_all(int fd, void *buf, size_t len);
+char read_all(int fd, void *buf, size_t len);
+
+/*Writes header_len bytes of header followed by the board to the file descriptor fd in a single write,
+ * the board as a record that can be read by receive_board. A NULL board is sent as a failure record*/
+void send_board(int fd, void *header, size_t header_len, game_board *board);
+
+/*Reads a record written by send_board into board, assumes board has the dimensions of the sent board
+ * Returns 1 if a board was read, 0 if a failure record was read and -1 on end of file*/
+int receive_board(int fd, game_board *board);
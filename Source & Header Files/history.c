@@ -0,0 +1,216 @@
+/*This module keeps the undo/redo history of a game as a single log of cell changes,
+ * with periodic snapshots of the board to jump far back or forward quickly*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "error_handler.h"
+#include "history.h"
+
+#define INITIAL_CAPACITY 64
+#define INITIAL_INTERVAL 16
+
+/*Creates an empty history, the log is allocated on the first move*/
+history create_history(int max_checkpoints){
+	history h;
+	h.deltas=NULL;
+	h.count=0;
+	h.position=0;
+	h.capacity=0;
+	h.moves=NULL;
+	h.move_count=0;
+	h.current_move=0;
+	h.moves_capacity=0;
+	h.max_checkpoints=max_checkpoints;
+	h.checkpoints=(checkpoint*)calloc(max_checkpoints+1,sizeof(checkpoint));
+	if(h.checkpoints==NULL) function_error(f_calloc);
+	h.checkpoint_count=0;
+	h.interval=INITIAL_INTERVAL;
+	h.cell_deltas=NULL;
+	h.cells_capacity=0;
+	return h;
+}
+
+/*Frees the checkpoints from index first on*/
+void drop_checkpoints(history *h, int first){
+	while(h->checkpoint_count>first)
+		free(h->checkpoints[--h->checkpoint_count].cells);
+}
+
+/*Starts recording a new move of the given kind
+ * As in the undo/redo stacks, a new move means the undone moves can't be redone anymore*/
+void begin_move(history *h, char kind){
+	int i;
+	h->count=h->position;
+	h->move_count=h->current_move;
+	for(i=0;i<h->checkpoint_count && h->checkpoints[i].move<=h->current_move;i++);
+	drop_checkpoints(h,i);
+	if(h->move_count==h->moves_capacity){
+		h->moves_capacity=h->moves_capacity?h->moves_capacity*2:INITIAL_CAPACITY;
+		h->moves=(move_info*)realloc(h->moves,sizeof(move_info)*h->moves_capacity);
+		if(h->moves==NULL) function_error(f_malloc);
+	}
+	h->moves[h->move_count].start=h->count;
+	h->moves[h->move_count].version=0;
+	h->moves[h->move_count].kind=kind;
+	h->move_count++;
+	h->current_move=h->move_count;
+}
+
+/*Returns the index of the change of the cell in the move being recorded, -1 if it wasn't changed yet
+ * The index kept for the cell may be stale (from an older move or a dropped one), so it's checked
+ * instead of clearing the indices on every move*/
+int find_cell_delta(history *h, int cell){
+	int i,old_capacity;
+	if(cell>=h->cells_capacity){
+		old_capacity=h->cells_capacity;
+		h->cells_capacity=h->cells_capacity?h->cells_capacity:INITIAL_CAPACITY;
+		while(h->cells_capacity<=cell)
+			h->cells_capacity*=2;
+		h->cell_deltas=(int*)realloc(h->cell_deltas,sizeof(int)*h->cells_capacity);
+		if(h->cell_deltas==NULL) function_error(f_malloc);
+		for(i=old_capacity;i<h->cells_capacity;i++)
+			h->cell_deltas[i]=-1;
+	}
+	i=h->cell_deltas[cell];
+	if(i>=h->moves[h->move_count-1].start && i<h->count && h->deltas[i].cell==cell)
+		return i;
+	return -1;
+}
+
+/*Adds a cell change to the move being recorded, merging it with an earlier change of the same cell*/
+void record_delta(history *h, int cell, int old_value, int new_value, char old_fixed, char new_fixed){
+	int i;
+	cell_delta *d;
+	i=find_cell_delta(h,cell);
+	if(i>=0){
+		h->deltas[i].new_value=(short)new_value;
+		h->deltas[i].new_fixed=new_fixed;
+		return;
+	}
+	if(h->count==h->capacity){
+		h->capacity=h->capacity?h->capacity*2:INITIAL_CAPACITY;
+		h->deltas=(cell_delta*)realloc(h->deltas,sizeof(cell_delta)*h->capacity);
+		if(h->deltas==NULL) function_error(f_malloc);
+	}
+	d=&h->deltas[h->count];
+	d->cell=cell;
+	d->old_value=(short)old_value;
+	d->new_value=(short)new_value;
+	d->old_fixed=old_fixed;
+	d->new_fixed=new_fixed;
+	h->cell_deltas[cell]=h->count;
+	h->count++;
+	h->position=h->count;
+}
+
+/*Doubles the interval and keeps only the checkpoints that fall on it*/
+void thin_checkpoints(history *h){
+	int i,kept=0;
+	h->interval*=2;
+	for(i=0;i<h->checkpoint_count;i++){
+		if(h->checkpoints[i].move%h->interval==0)
+			h->checkpoints[kept++]=h->checkpoints[i];
+		else
+			free(h->checkpoints[i].cells);
+	}
+	h->checkpoint_count=kept;
+}
+
+/*Ends the move being recorded, taking a checkpoint of the board if the move falls on the interval*/
+void end_move(history *h, game_board *board){
+	int x,y,len;
+	checkpoint *cp;
+	if(h->current_move%h->interval)
+		return;
+	if(h->checkpoint_count==h->max_checkpoints){
+		thin_checkpoints(h);
+		if(h->current_move%h->interval || !h->max_checkpoints)
+			return;
+	}
+	len=board_len(board);
+	cp=&h->checkpoints[h->checkpoint_count++];
+	cp->move=h->current_move;
+	cp->cells=(game_cell*)malloc(sizeof(game_cell)*len*len);
+	if(cp->cells==NULL) function_error(f_malloc);
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++)
+			cp->cells[y*len+x]=board->cells[x][y];
+	}
+}
+
+/*Marks move as the current one without changing the board*/
+void set_current_move(history *h, int move){
+	h->current_move=move;
+	h->position=(move<h->move_count)?h->moves[move].start:h->count;
+}
+
+/*Puts the range of deltas of the last applied move in [*start,*end) and marks it as undone
+ * Returns the kind of the move, or 0 if there is no move to undo*/
+char undo_move(history *h, int *start, int *end){
+	if(!h->current_move)
+		return 0;
+	*end=h->position;
+	set_current_move(h,h->current_move-1);
+	*start=h->position;
+	return h->moves[h->current_move].kind;
+}
+
+/*Puts the range of deltas of the next undone move in [*start,*end) and marks it as applied
+ * Returns the kind of the move, or 0 if there is no move to redo*/
+char redo_move(history *h, int *start, int *end){
+	if(h->current_move==h->move_count)
+		return 0;
+	*start=h->position;
+	set_current_move(h,h->current_move+1);
+	*end=h->position;
+	return h->moves[h->current_move-1].kind;
+}
+
+/*Finds the checkpoint closest to the given move, in either direction
+ * *closest is set to NULL when the closest one is the board before the first move
+ * Returns the number of moves between the checkpoint and the given move*/
+int closest_checkpoint(history *h, int move, checkpoint **closest){
+	int i,distance,best;
+	*closest=NULL;
+	best=move;
+	for(i=0;i<h->checkpoint_count;i++){
+		distance=abs(h->checkpoints[i].move-move);
+		if(distance<best){
+			best=distance;
+			*closest=&h->checkpoints[i];
+		}
+	}
+	return best;
+}
+
+/*Copies the cells of the checkpoint to the board and marks its move as the current one*/
+void restore_checkpoint(history *h, checkpoint *cp, game_board *board){
+	int x,y,len;
+	len=board_len(board);
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++)
+			board->cells[x][y]=cp->cells[y*len+x];
+	}
+	recount_board(board);
+	set_current_move(h,cp->move);
+}
+
+/*Removes all the moves, keeping the memory for the next game*/
+void clear_history(history *h){
+	h->count=0;
+	h->position=0;
+	h->move_count=0;
+	h->current_move=0;
+	drop_checkpoints(h,0);
+	h->interval=INITIAL_INTERVAL;
+}
+
+/*Frees the memory of the history*/
+void free_history(history *h){
+	drop_checkpoints(h,0);
+	free(h->deltas);
+	free(h->moves);
+	free(h->checkpoints);
+	free(h->cell_deltas);
+}
@@ -0,0 +1,86 @@
+/*This module keeps the undo/redo history of a game as a single log of cell changes,
+ * with periodic snapshots of the board to jump far back or forward quickly*/
+
+#ifndef _HISTORYH_
+#define _HISTORYH_
+
+#include "board.h"
+
+/*Kinds of moves*/
+#define MOVE_SET 1 /*A set command, always a single delta*/
+#define MOVE_MULTI 2 /*An autofill or generate command, any number of deltas*/
+
+/*A struct that represents a change of a single cell*/
+typedef struct cell_delta{
+	int cell; /*y*len+x*/
+	short old_value,new_value;
+	char old_fixed,new_fixed;
+} cell_delta;
+
+/*A struct that marks where a move starts in the log*/
+typedef struct move_info{
+	int start; /*Index of the first delta of the move*/
+	int version; /*Board version after the move, see versions.h*/
+	char kind;
+} move_info;
+
+/*A struct that keeps a copy of the cells of the board after a move*/
+typedef struct checkpoint{
+	int move; /*Number of moves applied when the copy was taken*/
+	game_cell *cells; /*Cell <x,y> is cells[y*len+x]*/
+} checkpoint;
+
+/*A struct that represents the history: a growable array of the deltas of all the moves,
+ * in the order they were made. Deltas before position (moves before current_move) are applied
+ * to the board, the ones after it belong to undone moves that can still be redone
+ * A checkpoint is taken after every interval moves. When there are max_checkpoints of them,
+ * the interval is doubled and every other checkpoint is dropped, which bounds their memory*/
+typedef struct history{
+	cell_delta *deltas;
+	int count,position,capacity;
+	move_info *moves;
+	int move_count,current_move,moves_capacity;
+	checkpoint *checkpoints; /*Ordered by move*/
+	int checkpoint_count,max_checkpoints,interval;
+	int *cell_deltas; /*Index in deltas of the last change of every cell, only trusted if it points at that cell in the current move*/
+	int cells_capacity;
+} history;
+
+/*Creates an empty history that keeps at most max_checkpoints board copies*/
+history create_history(int max_checkpoints);
+
+/*Starts recording a new move of the given kind, dropping all the moves that can be redone*/
+void begin_move(history *h, char kind);
+
+/*Adds a cell change to the move being recorded
+ * If the move already changed this cell, the two changes are merged into one*/
+void record_delta(history *h, int cell, int old_value, int new_value, char old_fixed, char new_fixed);
+
+/*Ends the move being recorded, board is the board after the move*/
+void end_move(history *h, game_board *board);
+
+/*Puts the range of deltas of the last applied move in [*start,*end) and marks it as undone
+ * Returns the kind of the move, or 0 if there is no move to undo*/
+char undo_move(history *h, int *start, int *end);
+
+/*Puts the range of deltas of the next undone move in [*start,*end) and marks it as applied
+ * Returns the kind of the move, or 0 if there is no move to redo*/
+char redo_move(history *h, int *start, int *end);
+
+/*Finds the checkpoint closest to the given move, NULL stands for the board before the first move
+ * Returns the number of moves between the checkpoint and the given move*/
+int closest_checkpoint(history *h, int move, checkpoint **closest);
+
+/*Copies the cells of the checkpoint to the board and marks its move as the current one*/
+void restore_checkpoint(history *h, checkpoint *cp, game_board *board);
+
+/*Marks move as the current one without changing the board, used after the board was replaced*/
+void set_current_move(history *h, int move);
+
+/*Removes all the moves, keeping the memory for the next game*/
+void clear_history(history *h);
+
+/*Frees the memory of the history*/
+void free_history(history *h);
+
+#endif
@@ -0,0 +1,172 @@
+/*This module runs the heavy commands of the console in the background, so the prompt returns
+ * at once and the status and cancel commands can be used while they run
+ * A job executes its command on a copy of the game data, which is copied back once it is collected*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "error_handler.h"
+#include "parser.h"
+#include "executer.h"
+#include "save_queue.h"
+#include "screen.h"
+#include "job.h"
+
+/*A struct that represents a command running in the background*/
+struct job{
+	game_data game; /*The copy of the game the command is executed on*/
+	commandInfo com;
+	char line[LINE_BUFFER_LEN]; /*The tokens of com*/
+	char holds_board; /*Set when the command may change the game, then the whole game is copied back*/
+	FILE *console; /*Where the result is printed once the command is done*/
+	char *output; /*Output of the command*/
+	size_t output_len;
+	struct timespec start;
+	long start_steps; /*Search steps of the context when the job started*/
+	pthread_t thread;
+	pthread_mutex_t lock; /*Held while the result is printed, and by the console while it prints*/
+	char done; /*Set once the result was printed (or skipped)*/
+	char silent; /*Set when the result should not be printed*/
+};
+
+/*The body of the job thread: executes the command and prints its result followed by a new prompt*/
+void *run_job(void *arg){
+	job *j=(job*)arg;
+	execute(&j->game,&j->com);
+	fclose(j->game.out);
+	pthread_mutex_lock(&j->lock);
+	if(!j->silent){
+		if(j->game.solver.aborted) /*A command that finished before it was cancelled is reported as usual*/
+			fprintf(j->console,"Command cancelled\n");
+		else
+			fwrite(j->output,1,j->output_len,j->console);
+		fprintf(j->console,COMMAND_PROMPT);
+		fflush(j->console);
+	}
+	j->done=1;
+	pthread_mutex_unlock(&j->lock);
+	return NULL;
+}
+
+/*Starts executing the command on a background thread, see job.h*/
+void start_job(game_data *game, commandInfo *com){
+	job *j;
+	j=(job*)calloc(1,sizeof(job));
+	if(j==NULL) function_error(f_calloc);
+	j->holds_board=(com->commandName==generate || com->commandName==save);
+	j->game=*game;
+	j->game.background=0;
+	j->game.job=NULL;
+	j->game.saves=NULL; /*The job is in the background already, its save writes the file at once*/
+	j->game.screen=NULL; /*The output of the job is printed as text*/
+	if(!j->holds_board)
+		j->game.journal=NULL; /*Nothing is journaled, and the console keeps committing the journal meanwhile*/
+	j->game.out=open_memstream(&j->output,&j->output_len);
+	if(j->game.out==NULL) function_error(f_malloc);
+	j->console=game->out;
+	copy_command(com,&j->com,j->line);
+	j->start_steps=game->solver.steps;
+	clock_gettime(CLOCK_MONOTONIC,&j->start);
+	pthread_mutex_init(&j->lock,NULL);
+	if(pthread_create(&j->thread,NULL,run_job,j)) function_error(f_thread);
+	game->job=j;
+	fprintf(game->out,"Running in the background, use status to follow it or cancel to stop it\n");
+}
+
+/*Returns 1 if the command may be executed while the job of the game runs*/
+char job_allows(game_data *game, func_name name){
+	switch(name){
+	case job_status:
+	case job_cancel:
+	case ex:
+	case invalid:
+		return 1;
+	case p_board:
+	case m_errors:
+	case list_versions:
+		return !game->job->holds_board;
+	default:
+		return 0;
+	}
+}
+
+/*Keeps the job from printing its result until release_job_output,
+ * so the result doesn't land in the middle of the output of a console command*/
+void hold_job_output(game_data *game){
+	pthread_mutex_lock(&game->job->lock);
+}
+
+/*Lets the job print its result again, see hold_job_output*/
+void release_job_output(game_data *game){
+	pthread_mutex_unlock(&game->job->lock);
+}
+
+/*Updates the game with the results of its job, whose thread was joined, and frees the job*/
+void absorb_job(game_data *game){
+	job *j=game->job;
+	FILE *out;
+	char background;
+	save_queue *saves;
+	screen *screen;
+	pthread_mutex_destroy(&j->lock);
+	if(j->holds_board){
+		out=game->out;
+		background=game->background;
+		saves=game->saves;
+		screen=game->screen;
+		*game=j->game;
+		game->out=out;
+		game->background=background;
+		game->saves=saves;
+		game->screen=screen;
+	}else{
+		game->solver=j->game.solver; /*The scratch memory may have been replaced*/
+	}
+	game->solver.cancelled=0;
+	game->solver.aborted=0;
+	game->job=NULL;
+	free(j->output);
+	free(j);
+}
+
+/*Collects the job of the game if it is done, see job.h*/
+void collect_job(game_data *game){
+	char done;
+	pthread_mutex_lock(&game->job->lock);
+	done=game->job->done;
+	pthread_mutex_unlock(&game->job->lock);
+	if(done){
+		pthread_join(game->job->thread,NULL);
+		absorb_job(game);
+	}
+}
+
+/*Prints how long the job of the game has been running and how far its search got*/
+void print_job_status(game_data *game){
+	job *j=game->job;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	fprintf(game->out,"Running for %.1f seconds, %ld search steps so far%s\n",
+			(now.tv_sec-j->start.tv_sec)+(now.tv_nsec-j->start.tv_nsec)/1e9,
+			j->game.solver.steps-j->start_steps,
+			j->game.solver.cancelled?" (cancelling)":"");
+}
+
+/*Asks the job of the game to stop*/
+void cancel_job(game_data *game){
+	game->job->game.solver.cancelled=1;
+}
+
+/*Cancels the job of the game, waits for it without printing its result and collects it*/
+void stop_job(game_data *game){
+	job *j=game->job;
+	pthread_mutex_lock(&j->lock);
+	j->silent=1;
+	pthread_mutex_unlock(&j->lock);
+	cancel_job(game);
+	pthread_join(j->thread,NULL);
+	absorb_job(game);
+}
@@ -0,0 +1,39 @@
+/*This module runs the heavy commands of the console in the background, so the prompt returns
+ * at once and the status and cancel commands can be used while they run
+ * A job executes its command on a copy of the game data, which is copied back once it is collected*/
+
+#ifndef _JOBH_
+#define _JOBH_
+
+#include "parser.h"
+#include "executer.h"
+
+typedef struct job job;
+
+/*Starts executing the command on a background thread, game->job is set until the job is collected*/
+void start_job(game_data *game, commandInfo *com);
+
+/*Returns 1 if the command may be executed while the job of the game runs
+ * A job of a command that changes the game holds the board, so only status, cancel and exit are allowed,
+ * otherwise only the commands that don't change the board*/
+char job_allows(game_data *game, func_name name);
+
+/*Keeps the job from printing its result until release_job_output,
+ * so the result doesn't land in the middle of the output of a console command*/
+void hold_job_output(game_data *game);
+void release_job_output(game_data *game);
+
+/*If the job of the game is done, collects it: the game is updated with its results and game->job is cleared*/
+void collect_job(game_data *game);
+
+/*Prints how long the job of the game has been running and how far its search got*/
+void print_job_status(game_data *game);
+
+/*Asks the job of the game to stop, the search stops at its next step and the job reports it was cancelled
+ * A command that was done before its search saw the request reports its result as usual*/
+void cancel_job(game_data *game);
+
+/*Cancels the job of the game and waits for it, the job prints nothing, then collects it*/
+void stop_job(game_data *game);
+
+#endif
@@ -0,0 +1,219 @@
+/*This module keeps an append-only journal of the cell changes of a game next to its board file
+ * A session can be restored after a crash by replaying the journal on top of the saved board
+ * The changes are written in batches by a background thread*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "board.h"
+#include "error_handler.h"
+#include "generator.h"
+#include "journal.h"
+
+#define SUFFIX ".journal"
+#define HEADER_CELL -1 /*The first record of a journal is a header, holding the length of the board*/
+#define INITIAL_CAPACITY 64
+
+/*A struct that represents a single record in the journal file: the state of a cell after a change
+ * Records are absolute, so replaying a record twice does no harm*/
+typedef struct journal_record{
+	int cell;
+	short value;
+	char fixed;
+	char unused;
+} journal_record;
+
+/*The changes are added to pending by the game and swapped into writing by the writer thread,
+ * so the game never waits for the disk unless the fsync policy asks for it*/
+struct journal{
+	char *path;
+	int fd;
+	int fsync_policy;
+	journal_record *pending,*writing;
+	int count,capacity,writing_capacity;
+	char busy; /*Set while the writer works on a batch*/
+	char stop;
+	char failed; /*Set when a write fails, the journal stops writing*/
+	pthread_mutex_t lock;
+	pthread_cond_t wake; /*Signals the writer there is work*/
+	pthread_cond_t drained; /*Signals the game a batch is written*/
+	pthread_t writer;
+};
+
+/*Returns a newly allocated string of the journal path for the board file at path*/
+char* journal_path(char *path){
+	char *result;
+	result=(char*)malloc(strlen(path)+strlen(SUFFIX)+1);
+	if(result==NULL) function_error(f_malloc);
+	strcpy(result,path);
+	strcat(result,SUFFIX);
+	return result;
+}
+
+/*Replays the journal of the board file at path on top of board
+ * A journal of a board of another size is ignored, a torn last record is dropped*/
+int replay_journal(char *path, game_board *board){
+	FILE *file;
+	char *name;
+	journal_record record;
+	int len,applied=0;
+	name=journal_path(path);
+	file=fopen(name,"rb");
+	free(name);
+	if(file==NULL)
+		return 0;
+	len=board_len(board);
+	if(fread(&record,sizeof(record),1,file)==1 && record.cell==HEADER_CELL && record.value==len){
+		while(fread(&record,sizeof(record),1,file)==1){
+			if(record.cell<0 || record.cell>=len*len || record.value<0 || record.value>len)
+				break;
+			set_cell(board,record.cell%len,record.cell/len,record.value);
+			board->cells[record.cell%len][record.cell/len].is_fixed=record.fixed;
+			applied++;
+		}
+	}
+	fclose(file);
+	return applied;
+}
+
+/*The body of the writer thread: writes whatever is pending as one batch, until the journal closes*/
+void* run_writer(void *arg){
+	journal *j=(journal*)arg;
+	journal_record *batch;
+	int count,capacity;
+	char failed;
+	pthread_mutex_lock(&j->lock);
+	while(1){
+		while(!j->count && !j->stop)
+			pthread_cond_wait(&j->wake,&j->lock);
+		if(!j->count)
+			break;
+		batch=j->pending; /*Swapping the buffers, the game keeps adding to the other one*/
+		capacity=j->capacity;
+		count=j->count;
+		j->pending=j->writing;
+		j->capacity=j->writing_capacity;
+		j->writing=batch;
+		j->writing_capacity=capacity;
+		j->count=0;
+		j->busy=1;
+		failed=j->failed;
+		pthread_mutex_unlock(&j->lock);
+		if(!failed){
+			failed=!write_all(j->fd,batch,sizeof(journal_record)*count);
+			if(!failed && j->fsync_policy!=JOURNAL_FSYNC_NEVER)
+				fsync(j->fd);
+		}
+		pthread_mutex_lock(&j->lock);
+		if(failed && !j->failed)
+			j->failed=1;
+		j->busy=0;
+		pthread_cond_broadcast(&j->drained);
+	}
+	pthread_mutex_unlock(&j->lock);
+	return NULL;
+}
+
+/*Opens the journal of the board file at path for appending, writing a header to a new journal*/
+journal* open_journal(char *path, int len, int fsync_policy, char restart){
+	journal *j;
+	struct stat st;
+	journal_record header;
+	j=(journal*)calloc(1,sizeof(journal));
+	if(j==NULL) function_error(f_calloc);
+	j->path=journal_path(path);
+	j->fd=open(j->path,O_WRONLY|O_CREAT|O_APPEND|(restart?O_TRUNC:0),0644);
+	if(j->fd<0 || fstat(j->fd,&st)){
+		if(j->fd>=0)
+			close(j->fd);
+		free(j->path);
+		free(j);
+		return NULL;
+	}
+	if(!st.st_size){
+		header.cell=HEADER_CELL;
+		header.value=(short)len;
+		header.fixed=0;
+		header.unused=0;
+		j->failed=!write_all(j->fd,&header,sizeof(header));
+	}
+	j->fsync_policy=fsync_policy;
+	j->capacity=INITIAL_CAPACITY;
+	j->writing_capacity=INITIAL_CAPACITY;
+	j->pending=(journal_record*)malloc(sizeof(journal_record)*INITIAL_CAPACITY);
+	j->writing=(journal_record*)malloc(sizeof(journal_record)*INITIAL_CAPACITY);
+	if(j->pending==NULL || j->writing==NULL) function_error(f_malloc);
+	pthread_mutex_init(&j->lock,NULL);
+	pthread_cond_init(&j->wake,NULL);
+	pthread_cond_init(&j->drained,NULL);
+	if(pthread_create(&j->writer,NULL,run_writer,j)) function_error(f_thread);
+	return j;
+}
+
+/*Adds the current state of a cell to the pending batch*/
+void journal_cell(journal *j, int cell, int value, char fixed){
+	journal_record *record;
+	pthread_mutex_lock(&j->lock);
+	if(j->count==j->capacity){
+		j->capacity*=2;
+		j->pending=(journal_record*)realloc(j->pending,sizeof(journal_record)*j->capacity);
+		if(j->pending==NULL) function_error(f_malloc);
+	}
+	record=&j->pending[j->count++];
+	record->cell=cell;
+	record->value=(short)value;
+	record->fixed=fixed;
+	record->unused=0;
+	pthread_mutex_unlock(&j->lock);
+}
+
+/*Waits until everything added so far is written, the lock must be held*/
+void wait_drained(journal *j){
+	pthread_cond_signal(&j->wake);
+	while(j->count || j->busy)
+		pthread_cond_wait(&j->drained,&j->lock);
+}
+
+/*Wakes the writer, and with JOURNAL_FSYNC_ALWAYS waits for it
+ * Returns 1 the first time after a write failed, so the failure can be reported*/
+char journal_commit(journal *j){
+	char report;
+	pthread_mutex_lock(&j->lock);
+	if(j->fsync_policy==JOURNAL_FSYNC_ALWAYS)
+		wait_drained(j);
+	else if(j->count)
+		pthread_cond_signal(&j->wake);
+	report=(j->failed==1);
+	if(report)
+		j->failed=2; /*Reported*/
+	pthread_mutex_unlock(&j->lock);
+	return report;
+}
+
+/*Writes the remaining changes, stops the writer and closes the journal*/
+void close_journal(journal *j, char discard){
+	pthread_mutex_lock(&j->lock);
+	wait_drained(j);
+	j->stop=1;
+	pthread_cond_signal(&j->wake);
+	pthread_mutex_unlock(&j->lock);
+	pthread_join(j->writer,NULL);
+	if(j->fsync_policy!=JOURNAL_FSYNC_NEVER)
+		fsync(j->fd);
+	close(j->fd);
+	if(discard)
+		unlink(j->path);
+	pthread_mutex_destroy(&j->lock);
+	pthread_cond_destroy(&j->wake);
+	pthread_cond_destroy(&j->drained);
+	free(j->pending);
+	free(j->writing);
+	free(j->path);
+	free(j);
+}
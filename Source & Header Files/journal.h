@@ -0,0 +1,36 @@
+/*This module keeps an append-only journal of the cell changes of a game next to its board file
+ * A session can be restored after a crash by replaying the journal on top of the saved board
+ * The changes are written in batches by a background thread*/
+
+#ifndef _JOURNALH_
+#define _JOURNALH_
+
+#include "board.h"
+
+/*When the journal forces its writes to the disk*/
+#define JOURNAL_OFF -1 /*No journal is kept*/
+#define JOURNAL_FSYNC_NEVER 0 /*Left to the operating system*/
+#define JOURNAL_FSYNC_BATCH 1 /*After every batch, in the background*/
+#define JOURNAL_FSYNC_ALWAYS 2 /*Every command waits until its changes are on the disk*/
+
+typedef struct journal journal;
+
+/*Replays the journal of the board file at path on top of board
+ * Returns the number of changes applied, 0 if there is no usable journal*/
+int replay_journal(char *path, game_board *board);
+
+/*Opens the journal of the board file at path for appending, starting a new one if it's empty
+ * or if restart is set. Returns NULL if it cannot be opened*/
+journal* open_journal(char *path, int len, int fsync_policy, char restart);
+
+/*Adds the current state of a cell to the journal, cell is y*len+x*/
+void journal_cell(journal *j, int cell, int value, char fixed);
+
+/*Hands the changes added so far to the writer, called at the end of every command
+ * Returns 1 the first time after a write failed, so the failure can be reported*/
+char journal_commit(journal *j);
+
+/*Writes the remaining changes and closes the journal, deleting its file if discard is set*/
+void close_journal(journal *j, char discard);
+
+#endif
@@ -0,0 +1,325 @@
+/*This module runs the batch modes that solve whole files of puzzles: -solve-lines solves a file of puzzles
+ * written one per line (e.g. the common datasets of 81 character lines) through a pipeline of a reader thread,
+ * solver threads and a writer that keeps the input order, and -solve-archive solves the boards of a
+ * compressed archive as it is decompressed
+ *
+ * A line holds the cells row by row, a digit for a value and '0' or '.' for an empty cell,
+ * so boards of up to 9x9 can be written this way. The result of a line is the solved board in
+ * the same form, "none" if the puzzle has no solution or "invalid" if the line isn't a puzzle*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "board.h"
+#include "parser.h"
+#include "error_handler.h"
+#include "solver_context.h"
+#include "exhaustive_solver.h"
+#include "autofill.h"
+#include "archive.h"
+#include "file_operations.h"
+#include "batch.h"
+#include "line_solver.h"
+
+#define SOLVE_LINES_ARGS 4 /*program name, -solve-lines (or -solve-archive) and its 2 arguments*/
+#define LINE_WINDOW 4096 /*Lines between the reader and the writer, bounds the memory for any input size*/
+#define MAX_LINE_LEN 9 /*Largest board a line can hold, every value is a single digit*/
+#define NO_SOLUTION "none\n"
+#define INVALID_LINE "invalid\n"
+
+/*An enum for the states of a slot of the window*/
+typedef enum slot_state{
+	slot_free,slot_read,slot_solved
+} slot_state;
+
+/*A struct that holds a single line on its way through the pipeline
+ * The line is replaced by its result once it is solved*/
+typedef struct line_slot{
+	char line[LINE_BUFFER_LEN];
+	char too_long; /*Set when the line didn't fit in the buffer*/
+	slot_state state;
+} line_slot;
+
+/*A struct that keeps the state of the pipeline
+ * Line number i is kept in slots[i%LINE_WINDOW], the reader waits while the window is full*/
+typedef struct line_pipeline{
+	FILE *in;
+	line_slot *slots;
+	long read; /*Lines read so far*/
+	long claimed; /*Lines taken by the solvers so far*/
+	long written; /*Lines written so far*/
+	long solved; /*Puzzles that were solved*/
+	char input_done; /*Set once the reader reached the end of the input*/
+	pthread_mutex_t lock;
+	pthread_cond_t slot_freed,line_read,line_solved;
+} line_pipeline;
+
+/*Returns the block_rows of a board of the given length, the largest divisor that isn't above its square root*/
+int line_block_rows(int len){
+	int rows=1,d;
+	for(d=1;d*d<=len;d++){
+		if(len%d==0)
+			rows=d;
+	}
+	return rows;
+}
+
+/*Solves the puzzle on the board, its non-empty cells are the givens and end up fixed
+ * The values the givens force are filled first, and fixed so the search won't revisit them
+ * Returns 1 if the board was solved, otherwise the board may be left partly filled*/
+char solve_puzzle(solver_context *ctx, game_board *board){
+	fix_all_cells(board);
+	if(board->errors)
+		return 0;
+	free_fills(autofill_deduce(board));
+	fix_all_cells(board);
+	return solve_in_place(ctx,board);
+}
+
+/*Replaces the line with its result, a fresh board is used for every line since the dimensions may differ*/
+void solve_line(solver_context *ctx, line_slot *slot){
+	game_board board;
+	int count,len,i,values[MAX_LINE_LEN*MAX_LINE_LEN];
+	char *line=slot->line;
+	for(count=0;line[count] && line[count]!='\n' && line[count]!='\r';count++);
+	for(len=1;len<=MAX_LINE_LEN && len*len<count;len++);
+	if(slot->too_long || len>MAX_LINE_LEN || len*len!=count){
+		strcpy(line,INVALID_LINE);
+		return;
+	}
+	for(i=0;i<count;i++){
+		if(line[i]>='1' && line[i]<='0'+len)
+			values[i]=line[i]-'0';
+		else if(line[i]=='0' || line[i]=='.')
+			values[i]=0;
+		else
+			break;
+	}
+	if(i<count){
+		strcpy(line,INVALID_LINE);
+		return;
+	}
+	board=board_from_cells(line_block_rows(len),len/line_block_rows(len),values,NULL);
+	if(solve_puzzle(ctx,&board)){
+		for(i=0;i<count;i++)
+			line[i]=(char)('0'+board.cells[i%len][i/len].value);
+		line[count]='\n';
+		line[count+1]='\0';
+	}else{
+		strcpy(line,NO_SOLUTION);
+	}
+	free_board(&board);
+}
+
+/*The body of the reader thread: reads the lines into the window, waiting while it is full*/
+void *run_line_reader(void *arg){
+	line_pipeline *p=(line_pipeline*)arg;
+	line_slot *slot;
+	char rest[LINE_BUFFER_LEN];
+	size_t len;
+	while(1){
+		pthread_mutex_lock(&p->lock);
+		while(p->read-p->written==LINE_WINDOW)
+			pthread_cond_wait(&p->slot_freed,&p->lock);
+		pthread_mutex_unlock(&p->lock);
+		slot=&p->slots[p->read%LINE_WINDOW]; /*The slot is free, no other thread uses it*/
+		if(fgets(slot->line,LINE_BUFFER_LEN,p->in)==NULL)
+			break;
+		len=strlen(slot->line);
+		slot->too_long=0;
+		if(len==LINE_BUFFER_LEN-1 && slot->line[len-1]!='\n'){ /*Skipping the rest of the line*/
+			slot->too_long=1;
+			while(fgets(rest,LINE_BUFFER_LEN,p->in)!=NULL && rest[strlen(rest)-1]!='\n');
+		}
+		pthread_mutex_lock(&p->lock);
+		slot->state=slot_read;
+		p->read++;
+		pthread_cond_signal(&p->line_read);
+		pthread_mutex_unlock(&p->lock);
+	}
+	pthread_mutex_lock(&p->lock);
+	p->input_done=1;
+	pthread_cond_broadcast(&p->line_read);
+	pthread_cond_broadcast(&p->line_solved);
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+/*The body of a solver thread: takes the lines in the order they were read and solves them*/
+void *run_line_solver(void *arg){
+	line_pipeline *p=(line_pipeline*)arg;
+	solver_context ctx;
+	line_slot *slot;
+	char solved;
+	ctx=create_context(1); /*The search of solve_in_place makes no random choices*/
+	while(1){
+		pthread_mutex_lock(&p->lock);
+		while(p->claimed==p->read && !p->input_done)
+			pthread_cond_wait(&p->line_read,&p->lock);
+		if(p->claimed==p->read){
+			pthread_mutex_unlock(&p->lock);
+			break;
+		}
+		slot=&p->slots[p->claimed++%LINE_WINDOW];
+		pthread_mutex_unlock(&p->lock);
+		solve_line(&ctx,slot);
+		solved=(slot->line[0]>='0' && slot->line[0]<='9');
+		pthread_mutex_lock(&p->lock);
+		slot->state=slot_solved;
+		p->solved+=solved;
+		pthread_cond_broadcast(&p->line_solved);
+		pthread_mutex_unlock(&p->lock);
+	}
+	free_context(&ctx);
+	return NULL;
+}
+
+/*Writes the results in the input order, each one as soon as it and the ones before it are solved
+ * Runs until all the lines were written*/
+void write_lines(line_pipeline *p, FILE *out){
+	line_slot *slot;
+	while(1){
+		pthread_mutex_lock(&p->lock);
+		while(!(p->written<p->read && p->slots[p->written%LINE_WINDOW].state==slot_solved)
+				&& !(p->input_done && p->written==p->read))
+			pthread_cond_wait(&p->line_solved,&p->lock);
+		if(p->written==p->read){
+			pthread_mutex_unlock(&p->lock);
+			return;
+		}
+		slot=&p->slots[p->written%LINE_WINDOW];
+		pthread_mutex_unlock(&p->lock);
+		if(fputs(slot->line,out)==EOF) function_error(f_fprintf);
+		pthread_mutex_lock(&p->lock);
+		slot->state=slot_free;
+		p->written++;
+		pthread_cond_signal(&p->slot_freed);
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+/*Solves every puzzle of the input file and writes the results to the output file in the same order
+ * -jobs <J> sets the number of solver threads, one per core by default*/
+int batch_solve_lines(int argc, char *argv[]){
+	line_pipeline p;
+	FILE *out;
+	pthread_t reader,*solvers;
+	struct timespec start;
+	int i,jobs;
+	jobs=(int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(argc==SOLVE_LINES_ARGS+2 && !strcmp(argv[SOLVE_LINES_ARGS],"-jobs"))
+		jobs=string_to_int(argv[SOLVE_LINES_ARGS+1]);
+	else if(argc!=SOLVE_LINES_ARGS)
+		jobs=0;
+	if(jobs<=0){
+		printf("Usage: %s -solve-lines <input> <output> [-jobs <J>]\n",argv[0]);
+		return 1;
+	}
+	memset(&p,0,sizeof(p));
+	p.in=fopen(argv[2],"r");
+	if(p.in==NULL){
+		printf("Error: File doesn't exist or cannot be opened\n");
+		return 1;
+	}
+	out=fopen(argv[3],"w");
+	if(out==NULL){
+		printf("Error: File cannot be created or modified\n");
+		fclose(p.in);
+		return 1;
+	}
+	p.slots=(line_slot*)calloc(LINE_WINDOW,sizeof(line_slot));
+	solvers=(pthread_t*)malloc(sizeof(pthread_t)*jobs);
+	if(p.slots==NULL || solvers==NULL) function_error(f_calloc);
+	pthread_mutex_init(&p.lock,NULL);
+	pthread_cond_init(&p.slot_freed,NULL);
+	pthread_cond_init(&p.line_read,NULL);
+	pthread_cond_init(&p.line_solved,NULL);
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	if(pthread_create(&reader,NULL,run_line_reader,&p)) function_error(f_thread);
+	for(i=0;i<jobs;i++){
+		if(pthread_create(&solvers[i],NULL,run_line_solver,&p)) function_error(f_thread);
+	}
+	write_lines(&p,out);
+	pthread_join(reader,NULL);
+	for(i=0;i<jobs;i++)
+		pthread_join(solvers[i],NULL);
+	if(fclose(out)) function_error(f_fprintf);
+	fclose(p.in);
+
+	printf("Solved %ld of %ld puzzles in %.2f seconds (%.1f puzzles/sec)\n",
+			p.solved,p.written,elapsed_seconds(&start),p.written/(elapsed_seconds(&start)+1e-9));
+	pthread_mutex_destroy(&p.lock);
+	pthread_cond_destroy(&p.slot_freed);
+	pthread_cond_destroy(&p.line_read);
+	pthread_cond_destroy(&p.line_solved);
+	free(p.slots);
+	free(solvers);
+	return 0;
+}
+
+/*Solves every board of the archive and writes the solutions to the output file in the same order,
+ * a board that has no solution is written as it is
+ * The chunks are decompressed by -jobs <J> threads (one per core by default) ahead of the solver
+ * Returns the exit status of the program*/
+int batch_solve_archive(int argc, char *argv[]){
+	archive_reader *in;
+	board_writer *out;
+	game_board board,solution;
+	solver_context ctx;
+	struct timespec start;
+	long solved=0,total=0;
+	int jobs,status;
+	jobs=(int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(argc==SOLVE_LINES_ARGS+2 && !strcmp(argv[SOLVE_LINES_ARGS],"-jobs"))
+		jobs=string_to_int(argv[SOLVE_LINES_ARGS+1]);
+	else if(argc!=SOLVE_LINES_ARGS)
+		jobs=0;
+	if(jobs<=0){
+		printf("Usage: %s -solve-archive <input> <output> [-jobs <J>]\n",argv[0]);
+		return 1;
+	}
+	in=open_archive_reader(argv[2],jobs);
+	if(in==NULL){
+		printf("Error: File doesn't exist or cannot be opened\n");
+		return 1;
+	}
+	out=open_board_writer(argv[3]);
+	if(out==NULL){
+		printf("Error: File cannot be created or modified\n");
+		close_archive_reader(in);
+		return 1;
+	}
+	ctx=create_context(1);
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	while((status=next_archive_board(in,&board))==1){
+		solution=create_board(board.block_rows,board.block_columns);
+		copy_board(&board,&solution);
+		if(solve_puzzle(&ctx,&solution)){
+			solved++;
+			status=add_board(out,&solution);
+		}else{
+			status=add_board(out,&board);
+		}
+		total++;
+		free_board(&solution);
+		free_board(&board);
+		if(!status){
+			printf("Error: the boards are too large for the format of the output file\n");
+			break;
+		}
+	}
+	if(status<0)
+		printf("Error: the archive is damaged, board %ld cannot be read\n",total);
+	close_board_writer(out);
+	close_archive_reader(in);
+	free_context(&ctx);
+	printf("Solved %ld of %ld boards in %.2f seconds (%.1f boards/sec)\n",
+			solved,total,elapsed_seconds(&start),total/(elapsed_seconds(&start)+1e-9));
+	return status!=0;
+}
@@ -0,0 +1,12 @@
+/*This module runs the batch modes that solve whole files of puzzles: -solve-lines solves a file of puzzles
+ * written one per line (e.g. the common datasets of 81 character lines) through a pipeline of a reader thread,
+ * solver threads and a writer that keeps the input order, and -solve-archive solves the boards of a
+ * compressed archive as it is decompressed*/
+
+/*Solves every puzzle of the input file and writes the results to the output file in the same order
+ * Returns the exit status of the program*/
+int batch_solve_lines(int argc, char *argv[]);
+
+/*Solves every board of the archive given as the input file and writes the solutions to the output file
+ * Returns the exit status of the program*/
+int batch_solve_archive(int argc, char *argv[]);
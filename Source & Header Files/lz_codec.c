@@ -0,0 +1,126 @@
+/*This module implements a small LZ77 codec for the compressed archives, see lz_codec.h for the format*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "lz_codec.h"
+
+#define MIN_MATCH 4
+#define MAX_DISTANCE 65535
+#define HASH_BITS 12
+#define LENGTH_MASK 15
+
+/*Returns the most bytes lz_compress may write for size bytes*/
+size_t lz_bound(size_t size){
+	return size+size/255+16;
+}
+
+/*Returns the hash table index of the 4 bytes at p*/
+unsigned int hash_position(unsigned char *p){
+	unsigned long v=(unsigned long)p[0]|(unsigned long)p[1]<<8|(unsigned long)p[2]<<16|(unsigned long)p[3]<<24;
+	return (unsigned int)(((v*2654435761UL)&0xFFFFFFFFUL)>>(32-HASH_BITS));
+}
+
+/*Writes the extra bytes of a length that didn't fit in its 4 bits, returns the new end of dst*/
+unsigned char *write_length(unsigned char *dst, size_t length){
+	while(length>=255){
+		*dst++=255;
+		length-=255;
+	}
+	*dst++=(unsigned char)length;
+	return dst;
+}
+
+/*Writes a sequence of the given literals followed by a match (none if match_length is 0)
+ * Returns the new end of dst*/
+unsigned char *write_sequence(unsigned char *dst, unsigned char *literals, size_t literal_count,
+		size_t distance, size_t match_length){
+	unsigned char *token=dst++;
+	size_t extra=match_length?match_length-MIN_MATCH:0;
+	*token=(unsigned char)((literal_count<LENGTH_MASK?literal_count:LENGTH_MASK)<<4
+			|(extra<LENGTH_MASK?extra:LENGTH_MASK));
+	if(literal_count>=LENGTH_MASK)
+		dst=write_length(dst,literal_count-LENGTH_MASK);
+	memcpy(dst,literals,literal_count);
+	dst+=literal_count;
+	if(!match_length)
+		return dst;
+	*dst++=(unsigned char)(distance&0xFF);
+	*dst++=(unsigned char)(distance>>8);
+	if(extra>=LENGTH_MASK)
+		dst=write_length(dst,extra-LENGTH_MASK);
+	return dst;
+}
+
+/*Compresses size bytes of src into dst
+ * Matches are found through a table of the last position of every hash of 4 bytes*/
+size_t lz_compress(unsigned char *src, size_t size, unsigned char *dst){
+	size_t *table,i=0,anchor=0,candidate,length;
+	unsigned char *out=dst;
+	unsigned int h;
+	table=(size_t*)calloc((size_t)1<<HASH_BITS,sizeof(size_t)); /*Positions are kept plus 1, 0 is none*/
+	if(table==NULL) function_error(f_calloc);
+	while(size>=MIN_MATCH && i<=size-MIN_MATCH){
+		h=hash_position(src+i);
+		candidate=table[h];
+		table[h]=i+1;
+		if(candidate && i-(candidate-1)<=MAX_DISTANCE && !memcmp(src+candidate-1,src+i,MIN_MATCH)){
+			candidate--;
+			for(length=MIN_MATCH;i+length<size && src[candidate+length]==src[i+length];length++);
+			out=write_sequence(out,src+anchor,i-anchor,i-candidate,length);
+			i+=length;
+			anchor=i;
+		}else{
+			i++;
+		}
+	}
+	out=write_sequence(out,src+anchor,size-anchor,0,0);
+	free(table);
+	return out-dst;
+}
+
+/*Reads the extra bytes of a length into *length, returns 0 if the data ends first*/
+char read_length(unsigned char **src, unsigned char *end, size_t *length){
+	unsigned char b;
+	do{
+		if(*src==end)
+			return 0;
+		b=*(*src)++;
+		*length+=b;
+	}while(b==255);
+	return 1;
+}
+
+/*Decompresses size bytes of src into dst, every length and distance is checked before it is used*/
+char lz_decompress(unsigned char *src, size_t size, unsigned char *dst, size_t raw_size){
+	unsigned char *end=src+size,*out=dst,*out_end=dst+raw_size,token;
+	size_t literal_count,length,distance;
+	while(src<end){
+		token=*src++;
+		literal_count=token>>4;
+		if(literal_count==LENGTH_MASK && !read_length(&src,end,&literal_count))
+			return 0;
+		if(literal_count>(size_t)(end-src) || literal_count>(size_t)(out_end-out))
+			return 0;
+		memcpy(out,src,literal_count);
+		out+=literal_count;
+		src+=literal_count;
+		if(src==end) /*The last sequence*/
+			break;
+		if(end-src<2)
+			return 0;
+		distance=src[0]|(size_t)src[1]<<8;
+		src+=2;
+		length=token&LENGTH_MASK;
+		if(length==LENGTH_MASK && !read_length(&src,end,&length))
+			return 0;
+		length+=MIN_MATCH;
+		if(!distance || distance>(size_t)(out-dst) || length>(size_t)(out_end-out))
+			return 0;
+		while(length--){ /*Byte by byte, the match may overlap the bytes it writes*/
+			*out=*(out-distance);
+			out++;
+		}
+	}
+	return out==out_end;
+}
@@ -0,0 +1,24 @@
+/*This module implements a small LZ77 codec for the compressed archives (see archive.h)
+ *
+ * The compressed data is a list of sequences, each one a token byte (the number of literals in its
+ * high 4 bits, the match length minus 4 in its low 4 bits, 15 meaning more length bytes follow, each
+ * adding up to 255), the literals, and a match: a 16 bit little endian distance back into the output
+ * followed by the remaining match length bytes. The last sequence has only literals*/
+
+#ifndef _LZCODECH_
+#define _LZCODECH_
+
+#include <stddef.h>
+
+/*Returns the most bytes lz_compress may write for size bytes*/
+size_t lz_bound(size_t size);
+
+/*Compresses size bytes of src into dst, which holds lz_bound(size) bytes
+ * Returns the size of the compressed data*/
+size_t lz_compress(unsigned char *src, size_t size, unsigned char *dst);
+
+/*Decompresses size bytes of src into dst, which holds raw_size bytes
+ * Returns 0 if the data is invalid or doesn't decompress to exactly raw_size bytes*/
+char lz_decompress(unsigned char *src, size_t size, unsigned char *dst, size_t raw_size);
+
+#endif
@@ -1,34 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "error_handler.h"
 #include "parser.h"
-#include "stack_tools.h"
 #include "executer.h"
 #include "board.h"
+#include "batch.h"
+#include "puzzle_pool.h"
+#include "journal.h"
+#include "server.h"
+#include "solution_cache.h"
+#include "save_queue.h"
+#include "screen.h"
+
+
+
+#define DEFAULT_POOL_SIZE 4
+#define DEFAULT_CHECKPOINTS 64
+#define WARM_ARGS 5 /*-warm and its 4 arguments*/
+
+/*A struct that keeps how the game is played, when it isn't played on the console*/
+typedef struct run_options{
+	FILE *script; /*Commands to run in script mode, NULL if not used*/
+	char *socket_path; /*Unix domain socket to serve games on, NULL if not used*/
+	int port; /*TCP loopback port to serve games on, 0 if not used*/
+} run_options;
+
+/*Returns the fsync policy named by str, JOURNAL_OFF if there is no such policy*/
+int parse_fsync_policy(char *str){
+	if(!strcmp(str,"never"))
+		return JOURNAL_FSYNC_NEVER;
+	if(!strcmp(str,"batch"))
+		return JOURNAL_FSYNC_BATCH;
+	if(!strcmp(str,"always"))
+		return JOURNAL_FSYNC_ALWAYS;
+	return JOURNAL_OFF;
+}
 
+/*Checks the 4 arguments of a -warm option the same way the generate command does
+ * Returns 1 if they are valid, otherwise prints an error and returns 0*/
+char check_warm_args(char *args[]){
+	int block_rows,block_columns,x,y,cells;
+	block_rows=string_to_int(args[0]);
+	block_columns=string_to_int(args[1]);
+	x=string_to_int(args[2]);
+	y=string_to_int(args[3]);
+	if(block_rows<=0 || block_columns<=0 || block_rows>MAX_BOARD_LEN || block_rows*block_columns>MAX_BOARD_LEN){
+		printf("Error: -warm block dimensions must be positive, with up to %d cells in a block\n",MAX_BOARD_LEN);
+		return 0;
+	}
+	cells=block_rows*block_columns*block_rows*block_columns;
+	if(x<0 || x>cells || y<0 || y>cells){
+		printf("Error: -warm value not in range 0-%d\n",cells);
+		return 0;
+	}
+	return 1;
+}
 
+/*Handles the command line options of the interactive game:
+ * -pool <size> keeps up to size pre-generated puzzles per generate configuration
+ * -warm <block_rows> <block_columns> <X> <Y> fills the pool for a configuration from the start
+ * -checkpoints <count> bounds the number of board copies kept by the history
+ * -script [<file>] runs the commands of the file (or the standard input) without printing the board
+ * -journal keeps a journal of the changes next to the board file, with it -fsync never|batch|always
+ * sets when it is forced to the disk (batch by default)
+ * -server <path> or -server-port <port> serves games to clients of a socket instead of the console
+ * -atomic-save makes save write a temporary file and rename it over the saved file
+ * -cache <path> keeps the results of hint, validate and num_solutions in the cache file at path
+ * Returns 0 if the arguments don't belong to the interactive game*/
+char parse_game_options(int argc, char *argv[], game_data *game, run_options *run){
+	int i,pool_size=DEFAULT_POOL_SIZE,checkpoints=DEFAULT_CHECKPOINTS,fsync_policy=JOURNAL_FSYNC_BATCH;
+	char use_pool=0,use_journal=0;
+	for(i=1;i<argc;i++){
+		if(!strcmp(argv[i],"-pool") && i+1<argc && string_to_int(argv[i+1])>0){
+			pool_size=string_to_int(argv[++i]);
+			use_pool=1;
+		}
+		else if(!strcmp(argv[i],"-warm") && i+WARM_ARGS-1<argc){
+			if(!check_warm_args(argv+i+1))
+				exit(1);
+			i+=WARM_ARGS-1;
+			use_pool=1;
+		}
+		else if(!strcmp(argv[i],"-journal"))
+			use_journal=1;
+		else if(!strcmp(argv[i],"-fsync") && i+1<argc && parse_fsync_policy(argv[i+1])!=JOURNAL_OFF)
+			fsync_policy=parse_fsync_policy(argv[++i]);
+		else if(!strcmp(argv[i],"-script")){
+			run->script=stdin;
+			if(i+1<argc && argv[i+1][0]!='-'){
+				run->script=fopen(argv[++i],"r");
+				if(run->script==NULL){
+					printf("Error: File cannot be opened\n");
+					exit(1);
+				}
+			}
+		}
+		else if(!strcmp(argv[i],"-server") && i+1<argc)
+			run->socket_path=argv[++i];
+		else if(!strcmp(argv[i],"-server-port") && i+1<argc && string_to_int(argv[i+1])>0 && string_to_int(argv[i+1])<65536)
+			run->port=string_to_int(argv[++i]);
+		else if(!strcmp(argv[i],"-atomic-save"))
+			game->atomic_save=1;
+		else if(!strcmp(argv[i],"-cache") && i+1<argc){
+			game->cache=open_cache(argv[++i]);
+			if(game->cache==NULL){
+				printf("Error: cache file cannot be opened or isn't a cache\n");
+				exit(1);
+			}
+		}
+		else if(!strcmp(argv[i],"-checkpoints") && i+1<argc && string_to_int(argv[i+1])>=0)
+			checkpoints=string_to_int(argv[++i]);
+		else
+			return 0;
+	}
+	game->hist=create_history(checkpoints);
+	if(use_journal) /*-fsync alone doesn't turn the journal on*/
+		game->journal_fsync=fsync_policy;
+	if(use_pool)
+		game->pool=create_pool(pool_size);
+	for(i=1;i<argc;i++){
+		if(!strcmp(argv[i],"-warm")){
+			pool_warm(game->pool,string_to_int(argv[i+1]),string_to_int(argv[i+2]),
+					string_to_int(argv[i+3]),string_to_int(argv[i+4]));
+			i+=WARM_ARGS-1;
+		}
+	}
+	return 1;
+}
 
-int main(){
+int main(int argc, char *argv[]){
 	/*Game setup phase*/
 	game_data game;
-	commandInfo *com; /*Commands read from the user will be kept here*/
-	game.undo_stack=create_stack();
-	game.redo_stack=create_stack();
-	srand(time(NULL));
+	commandInfo com; /*Commands read from the user will be kept here*/
+	char line[LINE_BUFFER_LEN]; /*The line of the command, its tokens point into it*/
+	run_options run={NULL,NULL,0};
+	game.pool=NULL;
+	game.cache=NULL;
+	game.journal=NULL;
+	game.job=NULL;
+	game.saves=NULL;
+	game.screen=NULL;
+	game.background=0;
+	game.atomic_save=0;
+	game.journal_fsync=JOURNAL_OFF;
+	if(!parse_game_options(argc,argv,&game,&run)){ /*The arguments select one of the non-interactive modes*/
+		return run_batch(argc,argv);
+	}
 
+	game.solver = create_context(time(NULL));
 	game.state = init;
 	game.mark_errors = 1;
+	game.quiet = 0;
+	game.out = stdout;
+	game.session = 0;
+	game.exited = 0;
+	if(run.script!=NULL)
+		return run_script(&game,run.script);
+	if(run.socket_path!=NULL || run.port)
+		return run_server(&game,run.socket_path,run.port);
+	game.background = isatty(STDIN_FILENO); /*Piped commands keep running one after the other*/
+	if(game.background)
+		game.saves = create_save_queue();
+	game.screen = open_screen(stdout); /*NULL unless the output is a terminal*/
 	printf("Sudoku\n------\n");
 
 	/*Game phase - constanly read commands and execute them*/
 	while(1){
-		printf("Enter your command:\n");
+		report_saves(&game);
+		update_screen(&game);
+		printf(COMMAND_PROMPT);
 		fflush(stdout);
-		com = readCommand();
-		execute(&game,com);
+		readCommand(stdin,line,&com);
+		execute(&game,&com);
 	}
 	return 0;
 }
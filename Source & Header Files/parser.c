@@ -6,8 +6,8 @@
 #include <string.h>
 #include "error_handler.h"
 #include "parser.h"
+#include "autofill.h"
 
-#define DELIM " \t\r\n"
 
 
 /*
@@ -29,164 +29,205 @@ int string_to_int(char *str){
 	return num;
 }
 
-/*Fills *cmd with command data.
- * Assumes strtok was called once on cmd->rawInput,
- * and *sep is the first token
- */
-void parseCommand(commandInfo *cmd,char* sep){
-	char *commandName;
-	int word_count=0; /*Counts the number of separate words read. We always consider only the first 4, as anything beyond that is irrelevant*/
-	while(sep!=NULL && word_count<4){
-		if(word_count==0){
-			commandName=sep;
-		}else
-		{
-			cmd->tokens[word_count-1]=sep;
-		}
-		word_count++;
-		sep=strtok(NULL,DELIM);
-	}
-	if(!strcmp(commandName,"set") && word_count > 3) /* Make sure we have enough parameters */
-	{
-		cmd->commandName=set;
+/*Returns 1 if c separates the words of a command*/
+char is_delim(char c){
+	return c==' ' || c=='\t' || c=='\r' || c=='\n';
+}
+
+/*Splits line into at most max_words words in place, terminating each one,
+ * and points words at them. Returns the number of words found*/
+int split_words(char *line, char **words, int max_words){
+	int count=0;
+	while(count<max_words){
+		while(is_delim(*line))
+			line++;
+		if(!*line)
+			break;
+		words[count++]=line;
+		while(*line && !is_delim(*line))
+			line++;
+		if(*line)
+			*line++='\0';
+	}
+	return count;
+}
+
+/*Returns the command called name, invalid if there is none
+ * The length of the name is checked first, so a name is compared to no more than a few others*/
+func_name command_by_name(char *name){
+	switch(strlen(name)){
+	case 3:
+		if(!memcmp(name,"set",3)) return set;
+		break;
+	case 4:
+		if(!memcmp(name,"hint",4)) return hint;
+		if(!memcmp(name,"exit",4)) return ex;
+		if(!memcmp(name,"undo",4)) return undo;
+		if(!memcmp(name,"redo",4)) return redo;
+		if(!memcmp(name,"save",4)) return save;
+		if(!memcmp(name,"edit",4)) return edit_command;
+		break;
+	case 5:
+		if(!memcmp(name,"reset",5)) return reset;
+		if(!memcmp(name,"solve",5)) return solve_command;
+		break;
+	case 6:
+		if(!memcmp(name,"status",6)) return job_status;
+		if(!memcmp(name,"cancel",6)) return job_cancel;
+		break;
+	case 8:
+		if(!memcmp(name,"validate",8)) return validate;
+		if(!memcmp(name,"autofill",8)) return autofill;
+		if(!memcmp(name,"generate",8)) return generate;
+		if(!memcmp(name,"checkout",8)) return checkout;
+		if(!memcmp(name,"versions",8)) return list_versions;
+		break;
+	case 9:
+		if(!memcmp(name,"goto_move",9)) return goto_move;
+		break;
+	case 11:
+		if(!memcmp(name,"mark_errors",11)) return m_errors;
+		if(!memcmp(name,"print_board",11)) return p_board;
+		break;
+	case 13:
+		if(!memcmp(name,"num_solutions",13)) return num_solutions;
+		break;
+	}
+	return invalid;
+}
+
+/*Fills *cmd with the command in words, word_count>0
+ * The tokens point to the words themselves, nothing is copied*/
+void parseCommand(commandInfo *cmd, char **words, int word_count){
+	int i;
+	for(i=0;i<3;i++){
+		cmd->tokens[i]=(i+1<word_count)?words[i+1]:NULL; /*A missing argument is NULL (e.g. edit without a filepath)*/
+		cmd->args[i]=0;
+	}
+	cmd->commandName=command_by_name(words[0]);
+	switch(cmd->commandName){
+	case set:
+		if(word_count<=3) /* Make sure we have enough parameters */
+			break;
 		cmd->args[0]=string_to_int(cmd->tokens[0])-1; /*if the token is not a valid integer, args[0] will be negative and will be treated as out of range in the executer*/
 		cmd->args[1]=string_to_int(cmd->tokens[1])-1;
 		cmd->args[2]=string_to_int(cmd->tokens[2]);
-	}
-	else if(!strcmp(commandName,"hint") && word_count > 2)/* Make sure we have enough parameters */
-	{
-		cmd->commandName=hint;
+		return;
+	case hint:
+		if(word_count<=2)
+			break;
 		cmd->args[0]=string_to_int(cmd->tokens[0])-1;
 		cmd->args[1]=string_to_int(cmd->tokens[1])-1;
-	}
-	else if(!strcmp(commandName,"validate"))
-	{
-		cmd->commandName=validate;
-	}
-	else if(!strcmp(commandName,"exit"))
-	{
-		cmd->commandName=ex;
-	}
-	else if(!strcmp(commandName,"undo"))
-	{
-		cmd->commandName=undo;
-	}
-	else if(!strcmp(commandName,"redo"))
-	{
-		cmd->commandName=redo;
-	}
-	else if(!strcmp(commandName,"reset"))
-	{
-		cmd->commandName=reset;
-	}
-	else if(!strcmp(commandName,"mark_errors") && word_count>1)
-	{
-		cmd->commandName=m_errors;
+		return;
+	case generate:
+		if(word_count<=2)
+			break;
 		cmd->args[0]=string_to_int(cmd->tokens[0]);
-	}
-	else if(!strcmp(commandName,"print_board"))
-	{
-		cmd->commandName=p_board;
-	}
-	else if(!strcmp(commandName,"autofill"))
-	{
-			cmd->commandName=autofill;
-	}
-	else if(!strcmp(commandName,"num_solutions"))
-	{
-			cmd->commandName=num_solutions;
-	}else if(!strcmp(commandName,"save") && word_count>1){
-		cmd->commandName = save;
-	}else if(!strcmp(commandName,"solve") && word_count>1){
-		cmd->commandName = solve_command;
-	}
-	else if(!strcmp(commandName,"edit"))
-	{
-		cmd->commandName=edit_command;
-		if(word_count==1)
-			cmd->tokens[0]=NULL; /*If no filepath was given, indicate it by setting the argument to NULL*/
-	}
-	else if(!strcmp(commandName,"generate") && word_count>2)
-	{
-		cmd->commandName=generate;
-		cmd->args[0] = string_to_int(cmd->tokens[0]);
-		cmd->args[1] = string_to_int(cmd->tokens[1]);
-	}
-	else
-	{
-		cmd->commandName=invalid;
-	}
-	cmd->autofill_values=NULL;
+		cmd->args[1]=string_to_int(cmd->tokens[1]);
+		return;
+	case m_errors:
+	case goto_move:
+	case checkout:
+		if(word_count<=1)
+			break;
+		cmd->args[0]=string_to_int(cmd->tokens[0]);
+		return;
+	case undo:
+		if(word_count>1)
+			cmd->args[0]=string_to_int(cmd->tokens[0]); /*undo N, plain undo leaves tokens[0] NULL*/
+		return;
+	case autofill:
+		cmd->args[0]=AUTOFILL_SINGLE_PASS;
+		if(word_count>1 && !strcmp(cmd->tokens[0],"all"))
+			cmd->args[0]=AUTOFILL_FIXPOINT;
+		else if(word_count>1 && !strcmp(cmd->tokens[0],"deep"))
+			cmd->args[0]=AUTOFILL_DEDUCE;
+		return;
+	case save:
+	case solve_command:
+		if(word_count<=1)
+			break;
+		return;
+	default:
+		return;
+	}
+	cmd->commandName=invalid; /*Not enough parameters*/
 }
 
-/*Returns a commandInfo struct that contains the information needed to perform a command
- * (See commandInfo and func_name sturcts documentation in the header file)*/
-commandInfo* readCommand()
+/*Parses the command in line into *cmd, splitting line in place so the tokens point into it
+ * Returns 0 if the line has no words*/
+char parse_line(char *line, commandInfo *cmd)
 {
+	char *words[4]; /*We always consider only the first 4 words, as anything beyond that is irrelevant*/
+	int word_count;
+	word_count=split_words(line,words,4);
+	if(word_count == 0)
+		return 0;
+	parseCommand(cmd,words,word_count);
+	return 1;
+}
 
-	char *sep = NULL;
-	commandInfo *cmd;
-	cmd=(commandInfo*)calloc(1,sizeof(commandInfo));
-	if(cmd == NULL) function_error(f_calloc);
-	cmd->rawInput = (char*)calloc(MAX_INPUT_LEN+2,1);
-	if(cmd->rawInput == NULL)function_error(f_calloc);
-	while(sep == NULL){
-		if(feof(stdin)){ /*reached EOF, exit*/
-			cmd->commandName = ex;
-			return cmd;
-		}
-		fgets(cmd->rawInput,MAX_INPUT_LEN+2,stdin);
-		if(ferror(stdin)){
-			function_error(f_fgets);
+/*Reads a command from the given stream into *cmd (See commandInfo and func_name sturcts
+ * documentation in the header file). line is the buffer the line is read into, of LINE_BUFFER_LEN
+ * bytes, and the tokens of the command point into it until the next call*/
+void readCommand(FILE *in, char *line, commandInfo *cmd)
+{
+	do{
+		if(fgets(line,LINE_BUFFER_LEN,in) == NULL){
+			if(ferror(in)){
+				function_error(f_fgets);
+			}
+			cmd->commandName = ex; /*reached EOF, exit*/
+			return;
 		}
-		if(strlen(cmd->rawInput) == MAX_INPUT_LEN + 1){ /*line is too long*/
-			while(strlen(cmd->rawInput) == MAX_INPUT_LEN + 1){ /*finish reading the line*/
-				fgets(cmd->rawInput,MAX_INPUT_LEN+1,stdin);
-				if(ferror(stdin)){
-					function_error(f_fgets);
+		if(strlen(line) == MAX_INPUT_LEN + 1){ /*line is too long*/
+			while(strlen(line) == MAX_INPUT_LEN + 1){ /*finish reading the line*/
+				if(fgets(line,MAX_INPUT_LEN+1,in) == NULL){
+					if(ferror(in)){
+						function_error(f_fgets);
+					}
+					break;
 				}
 			}
 			cmd->commandName = invalid;
-			return cmd; /*exit with invalid command*/
-		}
-		if(cmd->rawInput[0] != '\0'){ /*if we din't get an empty line*/
-			sep=strtok(cmd->rawInput,DELIM); /*will check if there are any tokens in input*/
+			return; /*exit with invalid command*/
 		}
+	}while(!parse_line(line,cmd));
+}
+
+/*Copies the command in source to target, the tokens are copied one after the other into line
+ * so target no longer depends on the line source was read from
+ * The tokens of a command come from a single line, so they always fit in LINE_BUFFER_LEN bytes*/
+void copy_command(commandInfo *source, commandInfo *target, char *line)
+{
+	int i;
+	size_t len;
+	*target=*source;
+	for(i=0;i<3;i++){
+		if(source->tokens[i]==NULL)
+			continue;
+		len=strlen(source->tokens[i])+1;
+		memcpy(line,source->tokens[i],len);
+		target->tokens[i]=line;
+		line+=len;
 	}
-	parseCommand(cmd,sep);
-	return cmd;
 }
 
 /*Prints prompt for the undo/redo commands
  * Set determines whether the action is undone (0) or redone(1)*/
-void print_undo_redo_prompt(int x, int y, int old_val, int new_val, char set)
+void print_undo_redo_prompt(int x, int y, int old_val, int new_val, char set, FILE *out)
 {
 	if(set)
-		printf("Redo ");
+		fprintf(out,"Redo ");
 	else
-		printf("Undo ");
-	printf("%d,%d: from ",x,y);
+		fprintf(out,"Undo ");
+	fprintf(out,"%d,%d: from ",x,y);
 	if(!old_val)
-		printf("_ to ");
+		fprintf(out,"_ to ");
 	else
-		printf("%d to ",old_val);
+		fprintf(out,"%d to ",old_val);
 	if(!new_val)
-			printf("_\n");
+			fprintf(out,"_\n");
 		else
-			printf("%d\n",new_val);
-}
-
-/*Frees the memory allocated to store a command info*/
-void free_command(commandInfo *com)
-{
-	int **p;
-	free(com->rawInput);
-	p=com->autofill_values;
-	if(p!=NULL)
-	{
-		for(;*p!=NULL;p++)
-			free(*p);
-		free(com->autofill_values);
-	}
-	free(com);
+			fprintf(out,"%d\n",new_val);
 }
@@ -1,26 +1,39 @@
 /*This module handles user interface, i.e. reading commands from the user
  * and converting it into data usable by the other modules*/
 
+#ifndef _PARSERH_
+#define _PARSERH_
+
+#include <stdio.h>
+#include "error_handler.h"
+
 /*An enum for all the possible commands recieved by the user*/
 typedef enum func_name
-{set, hint, validate, ex, undo, redo, reset,m_errors,p_board,autofill,num_solutions, invalid,solve_command,save,edit_command,generate} func_name;
+{set, hint, validate, ex, undo, redo, reset,m_errors,p_board,autofill,num_solutions, invalid,solve_command,save,edit_command,generate,goto_move,checkout,list_versions,job_status,job_cancel} func_name;
+
+/*The prompt printed before every command is read*/
+#define COMMAND_PROMPT "Enter your command:\n"
+
+/*Size of the buffer a line is read into, a line of MAX_INPUT_LEN characters, a newline and a terminator*/
+#define LINE_BUFFER_LEN (MAX_INPUT_LEN+2)
 
 /*A struct that holds all the relevant information from a command given by the user
  * func_name is the name of the commands, args is for its numerical arguments, no more than 3 are ever needed
- * rawInput saves the command as it was read from the user
- * tokens saves the arguments as strings, and converts them to numbers if necessary*/
+ * tokens saves the arguments as strings, pointing into the line the command was read from,
+ * and converts them to numbers if necessary*/
 typedef struct commandInfo
 {
-	char* rawInput;
 	func_name commandName;
 	char *tokens[3]; /*Arguments received as strings*/
 	int args[3]; /*Arguments converted to int if necessary*/
-	int prev_value; /*When a set command is undone, this is the previous value in the cell*/
-	int **autofill_values; /*Values for the autofill command*/
 
 } commandInfo;
-commandInfo* readCommand(); /*Reads the command given by the user*/
-void print_undo_redo_prompt(int x, int y, int old_val, int new_val, char set); /*Prints a fitting prompt for the undo/redo commands*/
-void free_command(commandInfo *com); /*Frees the memory allocated for a command*/
-
+char parse_line(char *line, commandInfo *cmd); /*Parses the command in line, its tokens point into line. Returns 0 for a line with no words*/
+/*Reads the command given by the user from the given stream, line is a buffer of LINE_BUFFER_LEN bytes*/
+void readCommand(FILE *in, char *line, commandInfo *cmd);
+/*Copies the command to target with its tokens copied into line, a buffer of LINE_BUFFER_LEN bytes*/
+void copy_command(commandInfo *source, commandInfo *target, char *line);
+void print_undo_redo_prompt(int x, int y, int old_val, int new_val, char set, FILE *out); /*Prints a fitting prompt for the undo/redo commands to out*/
+int string_to_int(char *str); /*Converts a string of digits to an integer, returns -1 if str is not a valid number*/
 
+#endif
@@ -0,0 +1,196 @@
+/*This module keeps a pool of ready puzzles for the generate command
+ * The puzzles are generated ahead of time by a background producer process*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "board.h"
+#include "error_handler.h"
+#include "solver_context.h"
+#include "generator.h"
+#include "puzzle_pool.h"
+
+#define REQUEST_LEN 4 /*block_rows,block_columns,x,y*/
+#define INITIAL_CONFIG_CAPACITY 4
+
+/*The body of the producer process: serves generation requests one by one
+ * until the pool closes the request pipe. Every answer is the request itself
+ * followed by a board record, written together once the puzzle is generated*/
+void run_producer(int request_fd, int response_fd){
+	int req[REQUEST_LEN];
+	game_board board;
+	solver_context ctx;
+	ctx=create_context(time(NULL)^getpid());
+	while(read_all(request_fd,req,sizeof(req))){
+		board=create_board(req[0],req[1]);
+		send_board(response_fd,req,sizeof(req),generate_puzzle(&ctx,&board,req[2],req[3],0)?&board:NULL);
+		free_board(&board);
+	}
+	free_context(&ctx);
+}
+
+/*Creates a pool keeping up to size puzzles per configuration and starts its producer*/
+puzzle_pool *create_pool(int size){
+	puzzle_pool *pool;
+	int requests[2],responses[2];
+	pool=(puzzle_pool*)calloc(1,sizeof(puzzle_pool));
+	if(pool==NULL) function_error(f_calloc);
+	pool->size=size;
+	pool->config_capacity=INITIAL_CONFIG_CAPACITY;
+	pool->configs=(pool_config*)calloc(pool->config_capacity,sizeof(pool_config));
+	if(pool->configs==NULL) function_error(f_calloc);
+	pthread_mutex_init(&pool->lock,NULL);
+	if(pipe(requests) || pipe(responses)) function_error(f_pipe);
+	signal(SIGPIPE,SIG_IGN); /*A dead producer is noticed by the failed writes instead*/
+	fflush(stdout);
+	pool->producer=fork();
+	if(pool->producer<0) function_error(f_fork);
+	if(pool->producer==0){
+		close(requests[1]);
+		close(responses[0]);
+		run_producer(requests[0],responses[1]);
+		_exit(0);
+	}
+	close(requests[0]);
+	close(responses[1]);
+	pool->request_fd=requests[1];
+	pool->response_fd=responses[0];
+	return pool;
+}
+
+/*Called when the producer is gone, nothing will be received anymore*/
+void producer_lost(puzzle_pool *pool){
+	int i;
+	if(pool->request_fd>=0) close(pool->request_fd);
+	if(pool->response_fd>=0) close(pool->response_fd);
+	pool->request_fd=-1;
+	pool->response_fd=-1;
+	for(i=0;i<pool->config_count;i++)
+		pool->configs[i].pending=0;
+}
+
+/*Returns the pool entry of the given configuration, adding it if it wasn't seen before*/
+pool_config *get_config(puzzle_pool *pool, int block_rows, int block_columns, int x, int y){
+	int i;
+	pool_config *conf;
+	for(i=0;i<pool->config_count;i++){
+		conf=&pool->configs[i];
+		if(conf->block_rows==block_rows && conf->block_columns==block_columns && conf->x==x && conf->y==y)
+			return conf;
+	}
+	if(pool->config_count==pool->config_capacity){
+		pool->config_capacity*=2;
+		pool->configs=(pool_config*)realloc(pool->configs,pool->config_capacity*sizeof(pool_config));
+		if(pool->configs==NULL) function_error(f_malloc);
+	}
+	conf=&pool->configs[pool->config_count++];
+	conf->block_rows=block_rows;
+	conf->block_columns=block_columns;
+	conf->x=x;
+	conf->y=y;
+	conf->ready=(game_board*)calloc(pool->size,sizeof(game_board));
+	if(conf->ready==NULL) function_error(f_calloc);
+	conf->ready_count=0;
+	conf->pending=0;
+	conf->failed=0;
+	return conf;
+}
+
+/*Requests puzzles from the producer until the configuration is full*/
+void refill(puzzle_pool *pool, pool_config *conf){
+	int req[REQUEST_LEN];
+	req[0]=conf->block_rows;
+	req[1]=conf->block_columns;
+	req[2]=conf->x;
+	req[3]=conf->y;
+	while(!conf->failed && pool->request_fd>=0 && conf->ready_count+conf->pending<pool->size){
+		if(!write_all(pool->request_fd,req,sizeof(req))){
+			producer_lost(pool);
+			return;
+		}
+		conf->pending++;
+	}
+}
+
+/*Moves every puzzle the producer has finished so far into the pool, without waiting*/
+void collect(puzzle_pool *pool){
+	struct pollfd pfd;
+	int req[REQUEST_LEN],status;
+	pool_config *conf;
+	game_board board;
+	pfd.fd=pool->response_fd;
+	pfd.events=POLLIN;
+	while(pool->response_fd>=0 && poll(&pfd,1,0)>0){
+		if(!read_all(pool->response_fd,req,sizeof(req))){
+			producer_lost(pool);
+			return;
+		}
+		conf=get_config(pool,req[0],req[1],req[2],req[3]);
+		board=create_board(req[0],req[1]);
+		status=receive_board(pool->response_fd,&board);
+		conf->pending--;
+		if(status==1){
+			conf->ready[conf->ready_count++]=board;
+			continue;
+		}
+		free_board(&board);
+		if(status<0){
+			producer_lost(pool);
+			return;
+		}
+		conf->failed=1; /*Don't keep asking for a configuration the generator can't produce*/
+	}
+}
+
+/*Starts filling the pool for the given configuration*/
+void pool_warm(puzzle_pool *pool, int block_rows, int block_columns, int x, int y){
+	pthread_mutex_lock(&pool->lock);
+	refill(pool,get_config(pool,block_rows,block_columns,x,y));
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*Replaces board with a ready puzzle of the same dimensions and the given X,Y if there is one
+ * Returns 1 if the board was replaced, otherwise returns 0*/
+char pool_take(puzzle_pool *pool, game_board *board, int x, int y){
+	pool_config *conf;
+	char taken=0;
+	if(pool==NULL)
+		return 0;
+	pthread_mutex_lock(&pool->lock);
+	collect(pool);
+	conf=get_config(pool,board->block_rows,board->block_columns,x,y);
+	if(conf->ready_count){
+		free_board(board);
+		*board=conf->ready[--conf->ready_count];
+		taken=1;
+	}
+	refill(pool,conf);
+	pthread_mutex_unlock(&pool->lock);
+	return taken;
+}
+
+/*Stops the producer and frees the pool with all its ready puzzles*/
+void free_pool(puzzle_pool *pool){
+	int i;
+	if(pool->producer>0){
+		kill(pool->producer,SIGTERM);
+		waitpid(pool->producer,NULL,0);
+	}
+	producer_lost(pool);
+	for(i=0;i<pool->config_count;i++){
+		while(pool->configs[i].ready_count)
+			free_board(&pool->configs[i].ready[--pool->configs[i].ready_count]);
+		free(pool->configs[i].ready);
+	}
+	free(pool->configs);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
@@ -0,0 +1,45 @@
+/*This module keeps a pool of ready puzzles for the generate command
+ * The puzzles are generated ahead of time by a background producer process*/
+
+#ifndef _POOLH_
+#define _POOLH_
+
+#include <pthread.h>
+#include "board.h"
+
+/*A struct that keeps the ready puzzles of a single generate configuration*/
+typedef struct pool_config{
+	int block_rows,block_columns,x,y; /*The configuration, same meaning as in the generate command*/
+	game_board *ready; /*Ready puzzles, used as a stack*/
+	int ready_count;
+	int pending; /*Puzzles requested from the producer and not received yet*/
+	char failed; /*Set when the producer failed to generate this configuration*/
+} pool_config;
+
+/*A struct that represents the pool and the connection to its producer process
+ * For every configuration, ready_count+pending never exceeds size
+ * The pool may be shared by threads, lock is held by every function of the module that uses it*/
+typedef struct puzzle_pool{
+	pthread_mutex_t lock;
+	int size; /*Maximum number of puzzles kept for each configuration*/
+	pool_config *configs;
+	int config_count,config_capacity;
+	int producer; /*pid of the producer process*/
+	int request_fd,response_fd; /*Pipes to and from the producer, -1 once it is gone*/
+} puzzle_pool;
+
+/*Creates a pool keeping up to size puzzles per configuration and starts its producer*/
+puzzle_pool *create_pool(int size);
+
+/*Starts filling the pool for the given configuration, before it is ever asked for*/
+void pool_warm(puzzle_pool *pool, int block_rows, int block_columns, int x, int y);
+
+/*If a puzzle of the given configuration is ready, replaces board with it (freeing the old board) and returns 1
+ * Otherwise returns 0, the configuration is remembered and filled for the next time
+ * A NULL pool never has ready puzzles*/
+char pool_take(puzzle_pool *pool, game_board *board, int x, int y);
+
+/*Stops the producer and frees the pool with all its ready puzzles*/
+void free_pool(puzzle_pool *pool);
+
+#endif
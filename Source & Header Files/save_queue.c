@@ -0,0 +1,162 @@
+/*This module writes the boards saved on the interactive console on a background I/O thread,
+ * see save_queue.h*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "board.h"
+#include "error_handler.h"
+#include "file_operations.h"
+#include "save_queue.h"
+
+/*A queued save, it moves from the pending list to the done list once it's written*/
+typedef struct save_request{
+	char *path;
+	game_board board;
+	char fix_cells;
+	char atomic;
+	char saved;
+	struct save_request *next;
+} save_request;
+
+struct save_queue{
+	save_request *pending,*pending_tail; /*Saves waiting to be written, oldest first*/
+	save_request *done,*done_tail; /*Saves written (or failed), oldest first*/
+	char writing; /*Set while the thread writes a save*/
+	char stop; /*Set when the thread should exit once the pending saves are written*/
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed; /*Signalled when a save is queued or done, or the thread should stop*/
+};
+
+/*Adds the request at the end of the list*/
+void append_request(save_request **head, save_request **tail, save_request *r){
+	r->next=NULL;
+	if(*head==NULL)
+		*head=r;
+	else
+		(*tail)->next=r;
+	*tail=r;
+}
+
+/*Frees the request and its copy of the board*/
+void free_request(save_request *r){
+	free(r->path);
+	free_board(&r->board);
+	free(r);
+}
+
+/*The body of the I/O thread: writes the pending saves one at a time*/
+void *run_saves(void *arg){
+	save_queue *q=(save_queue*)arg;
+	save_request *r;
+	pthread_mutex_lock(&q->lock);
+	while(1){
+		while(q->pending==NULL && !q->stop)
+			pthread_cond_wait(&q->changed,&q->lock);
+		if(q->pending==NULL)
+			break;
+		r=q->pending;
+		q->pending=r->next;
+		q->writing=1;
+		pthread_mutex_unlock(&q->lock);
+		r->saved=save_board(&r->board,r->path,r->fix_cells,r->atomic);
+		pthread_mutex_lock(&q->lock);
+		append_request(&q->done,&q->done_tail,r);
+		q->writing=0;
+		pthread_cond_broadcast(&q->changed);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return NULL;
+}
+
+/*Starts the I/O thread of a new queue*/
+save_queue *create_save_queue(void){
+	save_queue *q;
+	q=(save_queue*)calloc(1,sizeof(save_queue));
+	if(q==NULL) function_error(f_calloc);
+	pthread_mutex_init(&q->lock,NULL);
+	pthread_cond_init(&q->changed,NULL);
+	if(pthread_create(&q->thread,NULL,run_saves,q)) function_error(f_thread);
+	return q;
+}
+
+/*Queues a copy of the board to be saved to path
+ * A pending save to the same path is dropped, the new one goes to the end of the queue so the saves
+ * are still done in the order they were given*/
+void queue_save(save_queue *q, game_board *board, char *path, char fix_cells, char atomic){
+	save_request *r,*other,**link,*previous=NULL;
+	r=(save_request*)malloc(sizeof(save_request));
+	if(r==NULL) function_error(f_malloc);
+	r->path=(char*)malloc(strlen(path)+1);
+	if(r->path==NULL) function_error(f_malloc);
+	strcpy(r->path,path);
+	r->board=create_board(board->block_rows,board->block_columns);
+	copy_board(board,&r->board);
+	r->fix_cells=fix_cells;
+	r->atomic=atomic;
+	r->saved=0;
+	pthread_mutex_lock(&q->lock);
+	for(link=&q->pending;*link!=NULL;link=&(*link)->next){
+		if(!strcmp((*link)->path,path)){
+			previous=*link;
+			*link=previous->next;
+			break;
+		}
+	}
+	if(previous!=NULL){ /*The tail is found again in case it was the dropped save*/
+		q->pending_tail=NULL;
+		for(other=q->pending;other!=NULL;other=other->next)
+			q->pending_tail=other;
+	}
+	append_request(&q->pending,&q->pending_tail,r);
+	pthread_cond_broadcast(&q->changed);
+	pthread_mutex_unlock(&q->lock);
+	if(previous!=NULL)
+		free_request(previous);
+}
+
+/*Puts the oldest save that is done in *result, returns 0 if no save is done*/
+char next_save_result(save_queue *q, save_result *result){
+	save_request *r;
+	pthread_mutex_lock(&q->lock);
+	r=q->done;
+	if(r!=NULL)
+		q->done=r->next;
+	pthread_mutex_unlock(&q->lock);
+	if(r==NULL)
+		return 0;
+	result->path=r->path;
+	result->board=r->board;
+	result->saved=r->saved;
+	free(r);
+	return 1;
+}
+
+/*Waits until every queued save is done*/
+void wait_for_saves(save_queue *q){
+	pthread_mutex_lock(&q->lock);
+	while(q->pending!=NULL || q->writing)
+		pthread_cond_wait(&q->changed,&q->lock);
+	pthread_mutex_unlock(&q->lock);
+}
+
+/*Writes the queued saves, stops the thread and frees the queue*/
+void free_save_queue(save_queue *q){
+	save_request *r;
+	pthread_mutex_lock(&q->lock);
+	q->stop=1;
+	pthread_cond_broadcast(&q->changed);
+	pthread_mutex_unlock(&q->lock);
+	pthread_join(q->thread,NULL);
+	while(q->done!=NULL){
+		r=q->done;
+		q->done=r->next;
+		free_request(r);
+	}
+	pthread_cond_destroy(&q->changed);
+	pthread_mutex_destroy(&q->lock);
+	free(q);
+}
@@ -0,0 +1,36 @@
+/*This module writes the boards saved on the interactive console on a background I/O thread,
+ * so the save command returns as soon as the board is copied
+ * A save to a path that is still waiting to be written replaces the waiting one, so only the latest board
+ * of a path is written*/
+
+#ifndef _SAVEQUEUEH_
+#define _SAVEQUEUEH_
+
+#include "board.h"
+
+typedef struct save_queue save_queue;
+
+/*A save the thread is done with*/
+typedef struct save_result{
+	char *path;
+	game_board board; /*The board that was saved*/
+	char saved; /*0 if the file couldn't be written*/
+} save_result;
+
+/*Starts the I/O thread of a new queue*/
+save_queue *create_save_queue(void);
+
+/*Queues a copy of the board to be saved to path, see save_board for fix_cells and atomic*/
+void queue_save(save_queue *q, game_board *board, char *path, char fix_cells, char atomic);
+
+/*Puts the oldest save that is done in *result, the caller frees its path and board
+ * Returns 0 if no save is done*/
+char next_save_result(save_queue *q, save_result *result);
+
+/*Waits until every queued save is done*/
+void wait_for_saves(save_queue *q);
+
+/*Writes the queued saves, stops the thread and frees the queue, results that weren't taken are dropped*/
+void free_save_queue(save_queue *q);
+
+#endif
@@ -0,0 +1,144 @@
+/*This module keeps the board pinned to the top of an interactive terminal, see screen.h*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "board.h"
+#include "error_handler.h"
+#include "screen.h"
+
+#define MAX_SCREEN_LEN 99 /*Larger boards have cells wider than CELL_WIDTH*/
+#define MIN_SCROLL_LINES 4 /*The board is pinned only if at least that many lines are left below it*/
+#define MOVE_LEN 16 /*Most characters of a cursor movement*/
+
+struct screen{
+	FILE *out;
+	int fd;
+	int rows,columns; /*Size of the terminal when the board was drawn whole*/
+	int block_rows,block_columns; /*Dimensions of the board on the screen*/
+	char *cells; /*Text of every cell on the screen, CELL_WIDTH characters each, NULL if no board is pinned*/
+};
+
+/*Returns a screen on out, NULL if out isn't a terminal that supports cursor addressing*/
+screen *open_screen(FILE *out){
+	screen *s;
+	char *term;
+	term=getenv("TERM");
+	if(!isatty(fileno(out)) || term==NULL || !strcmp(term,"dumb"))
+		return NULL;
+	s=(screen*)calloc(1,sizeof(screen));
+	if(s==NULL) function_error(f_calloc);
+	s->out=out;
+	s->fd=fileno(out);
+	return s;
+}
+
+/*Returns the line of the screen the cells of row y are on, counting from 1*/
+int cell_line(game_board *board, int y){
+	return 2+y+y/board->block_rows; /*Below the separator lines above it*/
+}
+
+/*Returns the column of the screen the cells of column x start at, counting from 1*/
+int cell_column(game_board *board, int x){
+	return 2+x*CELL_WIDTH+x/board->block_columns; /*After the '|' of its block and the ones before it*/
+}
+
+/*Clears the terminal, draws the whole board at the top and makes the lines below it the scroll region*/
+void draw_whole(screen *s, game_board *board, char mark_fixed, char mark_errors, int lines){
+	char *frame,*buffer,*p;
+	size_t size;
+	int x,y,len;
+	len=board_len(board);
+	frame=render_board(board,mark_fixed,mark_errors,&size);
+	buffer=(char*)malloc(size+4*MOVE_LEN);
+	if(buffer==NULL) function_error(f_malloc);
+	p=buffer;
+	p+=sprintf(p,"\033[r\033[2J\033[H");
+	memcpy(p,frame,size);
+	p+=size;
+	p+=sprintf(p,"\033[%d;%dr\033[%d;1H",lines+1,s->rows,lines+1);
+	fwrite(buffer,1,p-buffer,s->out);
+	fflush(s->out);
+	free(frame);
+	free(buffer);
+	free(s->cells);
+	s->cells=(char*)malloc((size_t)len*len*CELL_WIDTH+1);
+	if(s->cells==NULL) function_error(f_malloc);
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++)
+			format_cell(board,mark_fixed,mark_errors,x,y,s->cells+(y*len+x)*CELL_WIDTH);
+	}
+	s->block_rows=board->block_rows;
+	s->block_columns=board->block_columns;
+}
+
+/*Repaints the cells whose text differs from the text on the screen, the cursor is kept where it was*/
+void draw_changes(screen *s, game_board *board, char mark_fixed, char mark_errors){
+	char *buffer,*p,*on_screen,text[CELL_WIDTH+1];
+	int x,y,len;
+	len=board_len(board);
+	buffer=(char*)malloc((size_t)len*len*(MOVE_LEN+CELL_WIDTH)+2*MOVE_LEN);
+	if(buffer==NULL) function_error(f_malloc);
+	p=buffer;
+	p+=sprintf(p,"\0337"); /*Saves the cursor*/
+	for(y=0;y<len;y++){
+		for(x=0;x<len;x++){
+			on_screen=s->cells+(y*len+x)*CELL_WIDTH;
+			format_cell(board,mark_fixed,mark_errors,x,y,text);
+			if(!memcmp(text,on_screen,CELL_WIDTH))
+				continue;
+			memcpy(on_screen,text,CELL_WIDTH);
+			p+=sprintf(p,"\033[%d;%dH",cell_line(board,y),cell_column(board,x));
+			memcpy(p,text,CELL_WIDTH);
+			p+=CELL_WIDTH;
+		}
+	}
+	if(p-buffer>2){ /*Something changed*/
+		p+=sprintf(p,"\0338");
+		fwrite(buffer,1,p-buffer,s->out);
+		fflush(s->out);
+	}
+	free(buffer);
+}
+
+/*Brings the board on the screen up to date, see screen.h*/
+char draw_screen(screen *s, game_board *board, char mark_fixed, char mark_errors){
+	struct winsize size;
+	int len,lines,width;
+	len=board_len(board);
+	lines=len+board->blocks_per_column+1;
+	width=len*CELL_WIDTH+board->blocks_per_row+1;
+	if(ioctl(s->fd,TIOCGWINSZ,&size) || len>MAX_SCREEN_LEN || lines+MIN_SCROLL_LINES>size.ws_row || width>size.ws_col){
+		release_screen(s);
+		return 0;
+	}
+	if(s->cells==NULL || s->block_rows!=board->block_rows || s->block_columns!=board->block_columns
+			|| s->rows!=size.ws_row || s->columns!=size.ws_col){
+		s->rows=size.ws_row;
+		s->columns=size.ws_col;
+		draw_whole(s,board,mark_fixed,mark_errors,lines);
+	}else{
+		draw_changes(s,board,mark_fixed,mark_errors);
+	}
+	return 1;
+}
+
+/*Unpins the board, the scroll region is reset and the cursor stays where it was*/
+void release_screen(screen *s){
+	if(s->cells==NULL)
+		return;
+	fputs("\0337\033[r\0338",s->out);
+	fflush(s->out);
+	free(s->cells);
+	s->cells=NULL;
+}
+
+/*Releases and frees the screen*/
+void close_screen(screen *s){
+	release_screen(s);
+	free(s);
+}
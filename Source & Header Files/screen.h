@@ -0,0 +1,27 @@
+/*This module keeps the board pinned to the top of an interactive terminal: the lines below it are a scroll
+ * region where the commands and their output scroll on their own, and after a change only the cells whose
+ * text changed are repainted, using cursor addressing (ANSI escape sequences)*/
+
+#ifndef _SCREENH_
+#define _SCREENH_
+
+#include <stdio.h>
+#include "board.h"
+
+typedef struct screen screen;
+
+/*Returns a screen on out, NULL if out isn't a terminal that supports cursor addressing*/
+screen *open_screen(FILE *out);
+
+/*Brings the board on the screen up to date, it is drawn whole when it was not on the screen yet
+ * or when its dimensions or the size of the terminal changed
+ * Returns 0 if the board doesn't fit in the terminal, then it should be printed instead*/
+char draw_screen(screen *s, game_board *board, char mark_fixed, char mark_errors);
+
+/*Unpins the board, its lines scroll away with the rest of the output*/
+void release_screen(screen *s);
+
+/*Releases and frees the screen*/
+void close_screen(screen *s);
+
+#endif
@@ -0,0 +1,429 @@
+/*This module runs the server mode: games are played over connections to a Unix domain socket
+ * (or a TCP loopback port), one game per connection, all served by a single epoll event loop
+ * Solver-heavy commands run on worker threads, so the other sessions are served meanwhile*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include "error_handler.h"
+#include "parser.h"
+#include "executer.h"
+#include "history.h"
+#include "server.h"
+
+#define MAX_EVENTS 64
+#define SEED_RANGE 0x7FFFFFFF /*Seeds of the session contexts are drawn from [0,SEED_RANGE)*/
+#define BANNER "Sudoku\n------\n"
+#define INITIAL_OUTPUT_CAPACITY 4096
+
+/*A struct that represents the connection of a single client and its game*/
+typedef struct session{
+	int fd;
+	game_data game;
+	char in[LINE_BUFFER_LEN]; /*Received bytes that don't form a command yet*/
+	int in_len;
+	char discarding; /*Set while the rest of a too long line is skipped*/
+	char line[LINE_BUFFER_LEN]; /*The line of the command being executed, its tokens point into it*/
+	commandInfo com;
+	char *out; /*Output waiting to be sent*/
+	size_t out_len,out_sent,out_capacity;
+	char *result; /*Output of the command a worker executed*/
+	size_t result_len;
+	char busy; /*Set while a worker executes a command of the session*/
+	char closed; /*Set when the client is gone while busy, the session is freed once the worker is done*/
+	unsigned int events; /*The events the session is registered for*/
+	struct session *next; /*Link in the job and done queues*/
+} session;
+
+/*A struct that keeps the state of the server*/
+typedef struct server{
+	int listen_fd,epoll_fd;
+	int wake_fd[2]; /*A pipe the workers write to when a job is done, to wake the event loop*/
+	game_data *defaults; /*The options every new game starts with*/
+	pthread_mutex_t lock;
+	pthread_cond_t has_jobs;
+	session *jobs,*jobs_tail; /*Sessions waiting for a worker*/
+	session *done; /*Sessions whose command was executed by a worker*/
+	session *dead; /*Closed sessions, freed after the events they may still have are skipped*/
+	pthread_t *workers; /*One worker per core, every session has its own solver context*/
+	int worker_count;
+} server;
+
+/*Sets the file descriptor to non-blocking mode, returns 0 on failure*/
+char set_nonblocking(int fd){
+	int flags=fcntl(fd,F_GETFL);
+	return flags>=0 && fcntl(fd,F_SETFL,flags|O_NONBLOCK)>=0;
+}
+
+/*Executes the command of the session, returning its output in *output (to be freed) and its length*/
+void run_command(session *s, char **output, size_t *len){
+	s->game.out=open_memstream(output,len);
+	if(s->game.out==NULL) function_error(f_malloc);
+	execute(&s->game,&s->com);
+	fclose(s->game.out);
+}
+
+/*Adds len bytes to the output of the session*/
+void append_output(session *s, char *data, size_t len){
+	if(s->out_len+len>s->out_capacity){
+		while(s->out_len+len>s->out_capacity)
+			s->out_capacity*=2;
+		s->out=(char*)realloc(s->out,s->out_capacity);
+		if(s->out==NULL) function_error(f_malloc);
+	}
+	memcpy(s->out+s->out_len,data,len);
+	s->out_len+=len;
+}
+
+/*Sends as much of the output of the session as the socket takes
+ * Returns 0 if the connection is broken*/
+char flush_output(session *s){
+	ssize_t sent;
+	while(s->out_sent<s->out_len){
+		sent=send(s->fd,s->out+s->out_sent,s->out_len-s->out_sent,MSG_NOSIGNAL);
+		if(sent<0){
+			if(errno==EINTR)
+				continue;
+			return errno==EAGAIN || errno==EWOULDBLOCK;
+		}
+		s->out_sent+=sent;
+	}
+	s->out_len=0;
+	s->out_sent=0;
+	return 1;
+}
+
+/*Registers the session for reading while it can take commands, and for writing while it has output*/
+void update_events(server *srv, session *s){
+	struct epoll_event ev;
+	unsigned int events=0;
+	if(!s->busy && !s->game.exited)
+		events|=EPOLLIN;
+	if(s->out_sent<s->out_len)
+		events|=EPOLLOUT;
+	if(events==s->events)
+		return;
+	s->events=events;
+	ev.events=events;
+	ev.data.ptr=s;
+	epoll_ctl(srv->epoll_fd,EPOLL_CTL_MOD,s->fd,&ev);
+}
+
+/*Closes the connection of the session, it is freed by free_dead_sessions*/
+void close_session(server *srv, session *s){
+	epoll_ctl(srv->epoll_fd,EPOLL_CTL_DEL,s->fd,NULL);
+	close(s->fd);
+	s->fd=-1;
+	s->next=srv->dead;
+	srv->dead=s;
+}
+
+/*Ends the connection of the session: while a worker executes a command of the session it is only
+ * taken out of the event loop, and finish_jobs closes it once the worker is done*/
+void drop_session(server *srv, session *s){
+	if(!s->busy){
+		close_session(srv,s);
+		return;
+	}
+	if(!s->closed){
+		s->closed=1;
+		epoll_ctl(srv->epoll_fd,EPOLL_CTL_DEL,s->fd,NULL);
+	}
+}
+
+/*Closes the session once it exited and all its output is sent, otherwise updates its events*/
+void settle_session(server *srv, session *s){
+	if(s->game.exited && s->out_len==0)
+		drop_session(srv,s);
+	else
+		update_events(srv,s);
+}
+
+/*Frees the closed sessions*/
+void free_dead_sessions(server *srv){
+	session *s;
+	while(srv->dead!=NULL){
+		s=srv->dead;
+		srv->dead=s->next;
+		free_game_data(&s->game);
+		free_history(&s->game.hist);
+		free_context(&s->game.solver);
+		free(s->out);
+		free(s);
+	}
+}
+
+/*Moves the next complete line of the input of the session to s->line
+ * Returns 0 if there is no complete line, 1 for a line and 2 for a line that is too long*/
+int next_line(session *s){
+	char *end;
+	int len;
+	while(1){
+		end=(char*)memchr(s->in,'\n',s->in_len);
+		if(end==NULL){
+			if(s->in_len<MAX_INPUT_LEN+1)
+				return 0;
+			s->in_len=0; /*The buffer is full and the line goes on*/
+			if(s->discarding)
+				continue;
+			s->discarding=1;
+			return 2;
+		}
+		len=end-s->in+1;
+		if(!s->discarding)
+			memcpy(s->line,s->in,len);
+		s->line[len]='\0';
+		s->in_len-=len;
+		memmove(s->in,end+1,s->in_len);
+		if(!s->discarding)
+			return 1;
+		s->discarding=0;
+	}
+}
+
+/*Executes the commands the session received, until a heavy one is handed to a worker
+ * Returns 0 if the connection is broken*/
+char process_input(server *srv, session *s){
+	char *output;
+	size_t len;
+	int status;
+	while(!s->busy && !s->game.exited && (status=next_line(s))){
+		if(status==2)
+			s->com.commandName=invalid;
+		else if(!parse_line(s->line,&s->com))
+			continue;
+		if(is_heavy_command(s->com.commandName)){
+			s->busy=1;
+			s->next=NULL;
+			pthread_mutex_lock(&srv->lock);
+			if(srv->jobs==NULL)
+				srv->jobs=s;
+			else
+				srv->jobs_tail->next=s;
+			srv->jobs_tail=s;
+			pthread_cond_signal(&srv->has_jobs);
+			pthread_mutex_unlock(&srv->lock);
+			break;
+		}
+		run_command(s,&output,&len);
+		append_output(s,output,len);
+		free(output);
+		if(!s->game.exited)
+			append_output(s,COMMAND_PROMPT,strlen(COMMAND_PROMPT));
+	}
+	return flush_output(s);
+}
+
+/*The body of a worker thread: executes the heavy commands of the sessions in the job queue*/
+void* run_worker(void *arg){
+	server *srv=(server*)arg;
+	session *s;
+	char byte=0;
+	while(1){
+		pthread_mutex_lock(&srv->lock);
+		while(srv->jobs==NULL)
+			pthread_cond_wait(&srv->has_jobs,&srv->lock);
+		s=srv->jobs;
+		srv->jobs=s->next;
+		pthread_mutex_unlock(&srv->lock);
+		run_command(s,&s->result,&s->result_len);
+		pthread_mutex_lock(&srv->lock);
+		s->next=srv->done;
+		srv->done=s;
+		pthread_mutex_unlock(&srv->lock);
+		while(write(srv->wake_fd[1],&byte,1)<0 && errno==EINTR);
+	}
+	return NULL;
+}
+
+/*Delivers the output of the commands the workers finished and resumes their sessions*/
+void finish_jobs(server *srv){
+	char buf[64];
+	session *s,*next;
+	while(read(srv->wake_fd[0],buf,sizeof(buf))>0);
+	pthread_mutex_lock(&srv->lock);
+	s=srv->done;
+	srv->done=NULL;
+	pthread_mutex_unlock(&srv->lock);
+	for(;s!=NULL;s=next){
+		next=s->next;
+		s->busy=0;
+		if(s->closed){
+			free(s->result);
+			close_session(srv,s);
+			continue;
+		}
+		append_output(s,s->result,s->result_len);
+		free(s->result);
+		append_output(s,COMMAND_PROMPT,strlen(COMMAND_PROMPT));
+		if(!process_input(srv,s))
+			drop_session(srv,s);
+		else
+			settle_session(srv,s);
+	}
+}
+
+/*Accepts the pending connections, each one starts a new game*/
+void accept_sessions(server *srv){
+	int fd;
+	session *s;
+	struct epoll_event ev;
+	while((fd=accept(srv->listen_fd,NULL,NULL))>=0){
+		if(!set_nonblocking(fd)){
+			close(fd);
+			continue;
+		}
+		s=(session*)calloc(1,sizeof(session));
+		if(s==NULL) function_error(f_calloc);
+		s->fd=fd;
+		s->game=*srv->defaults;
+		s->game.hist=create_history(srv->defaults->hist.max_checkpoints);
+		s->game.solver=create_context(random_below(&srv->defaults->solver,SEED_RANGE));
+		s->game.session=1;
+		s->out_capacity=INITIAL_OUTPUT_CAPACITY;
+		s->out=(char*)malloc(s->out_capacity);
+		if(s->out==NULL) function_error(f_malloc);
+		s->events=EPOLLIN;
+		ev.events=EPOLLIN;
+		ev.data.ptr=s;
+		if(epoll_ctl(srv->epoll_fd,EPOLL_CTL_ADD,fd,&ev)<0){
+			close_session(srv,s);
+			continue;
+		}
+		append_output(s,BANNER COMMAND_PROMPT,strlen(BANNER COMMAND_PROMPT));
+		if(!flush_output(s))
+			close_session(srv,s);
+		else
+			update_events(srv,s);
+	}
+}
+
+/*Handles an event of a session: new input, room for more output, or the client leaving*/
+void handle_session(server *srv, session *s, unsigned int events){
+	ssize_t received;
+	if(s->fd<0 || s->closed) /*Closed earlier in this round of events*/
+		return;
+	if(events&EPOLLIN){
+		received=recv(s->fd,s->in+s->in_len,MAX_INPUT_LEN+1-s->in_len,0);
+		if(received==0 || (received<0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)){
+			drop_session(srv,s);
+			return;
+		}
+		if(received>0)
+			s->in_len+=received;
+		if(!process_input(srv,s)){
+			drop_session(srv,s);
+			return;
+		}
+	}
+	else if(events&(EPOLLERR|EPOLLHUP)){
+		drop_session(srv,s);
+		return;
+	}
+	if((events&EPOLLOUT) && !flush_output(s)){
+		drop_session(srv,s);
+		return;
+	}
+	settle_session(srv,s);
+}
+
+/*Creates the listening socket, on the Unix domain socket at path or on the TCP loopback port
+ * Returns -1 on failure*/
+int open_listener(char *path, int port){
+	int fd,yes=1;
+	struct sockaddr_un local;
+	struct sockaddr_in inet;
+	if(path!=NULL){
+		if(strlen(path)>=sizeof(local.sun_path))
+			return -1;
+		fd=socket(AF_UNIX,SOCK_STREAM,0);
+		memset(&local,0,sizeof(local));
+		local.sun_family=AF_UNIX;
+		strcpy(local.sun_path,path);
+		unlink(path);
+		if(fd<0 || bind(fd,(struct sockaddr*)&local,sizeof(local))<0)
+			fd=(fd<0)?fd:(close(fd),-1);
+	}
+	else{
+		fd=socket(AF_INET,SOCK_STREAM,0);
+		memset(&inet,0,sizeof(inet));
+		inet.sin_family=AF_INET;
+		inet.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+		inet.sin_port=htons((unsigned short)port);
+		if(fd>=0)
+			setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&yes,sizeof(yes));
+		if(fd<0 || bind(fd,(struct sockaddr*)&inet,sizeof(inet))<0)
+			fd=(fd<0)?fd:(close(fd),-1);
+	}
+	if(fd>=0 && (listen(fd,SOMAXCONN)<0 || !set_nonblocking(fd))){
+		close(fd);
+		fd=-1;
+	}
+	return fd;
+}
+
+/*Runs the server until the process is killed, see server.h*/
+int run_server(game_data *defaults, char *path, int port){
+	server srv;
+	struct epoll_event ev,events[MAX_EVENTS];
+	int i,count;
+	memset(&srv,0,sizeof(srv));
+	srv.defaults=defaults;
+	srv.listen_fd=open_listener(path,port);
+	if(srv.listen_fd<0){
+		if(path!=NULL)
+			printf("Error: cannot listen on %s\n",path);
+		else
+			printf("Error: cannot listen on port %d\n",port);
+		return 1;
+	}
+	if(pipe(srv.wake_fd)<0) function_error(f_pipe);
+	set_nonblocking(srv.wake_fd[0]);
+	srv.epoll_fd=epoll_create(MAX_EVENTS);
+	if(srv.epoll_fd<0) function_error(f_poll);
+	ev.events=EPOLLIN;
+	ev.data.ptr=&srv.listen_fd;
+	epoll_ctl(srv.epoll_fd,EPOLL_CTL_ADD,srv.listen_fd,&ev);
+	ev.data.ptr=&srv.wake_fd[0];
+	epoll_ctl(srv.epoll_fd,EPOLL_CTL_ADD,srv.wake_fd[0],&ev);
+	pthread_mutex_init(&srv.lock,NULL);
+	pthread_cond_init(&srv.has_jobs,NULL);
+	srv.worker_count=(int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(srv.worker_count<1)
+		srv.worker_count=1;
+	srv.workers=(pthread_t*)malloc(sizeof(pthread_t)*srv.worker_count);
+	if(srv.workers==NULL) function_error(f_malloc);
+	for(i=0;i<srv.worker_count;i++){
+		if(pthread_create(&srv.workers[i],NULL,run_worker,&srv)) function_error(f_thread);
+	}
+	if(path!=NULL)
+		printf("Listening on %s\n",path);
+	else
+		printf("Listening on port %d\n",port);
+	fflush(stdout);
+	while(1){
+		count=epoll_wait(srv.epoll_fd,events,MAX_EVENTS,-1);
+		if(count<0 && errno!=EINTR) function_error(f_poll);
+		for(i=0;i<count;i++){
+			if(events[i].data.ptr==&srv.listen_fd)
+				accept_sessions(&srv);
+			else if(events[i].data.ptr==&srv.wake_fd[0])
+				finish_jobs(&srv);
+			else
+				handle_session(&srv,(session*)events[i].data.ptr,events[i].events);
+		}
+		free_dead_sessions(&srv);
+	}
+	return 0;
+}
@@ -0,0 +1,9 @@
+/*This module runs the server mode: games are played over connections to a Unix domain socket
+ * (or a TCP loopback port), one game per connection, all served by a single epoll event loop*/
+
+#include "executer.h"
+
+/*Listens on the Unix domain socket at path, or on the TCP loopback port if path is NULL,
+ * and plays a game with every client that connects, in the same command language as the console
+ * Every game starts with the options of defaults. Returns only if the socket can't be opened*/
+int run_server(game_data *defaults, char *path, int port);
@@ -0,0 +1,244 @@
+/*This module keeps what the solvers found out about boards in a file that outlives the process,
+ * see solution_cache.h for the layout*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "board.h"
+#include "error_handler.h"
+#include "binary_format.h"
+#include "transform.h"
+#include "solution_cache.h"
+
+#define CACHE_MAGIC "SDKC"
+#define CACHE_VERSION 1
+#define CACHE_HEADER_SIZE 16
+#define CACHE_SLOTS 16384 /*Must be a power of 2*/
+#define CACHE_SLOT_SIZE 512 /*Enough for the key and solution of a 16x16 board*/
+#define SLOT_HEADER_SIZE 16
+#define MAX_PROBES 16 /*Slots looked at for a key, a full run of them evicts the first one*/
+#define FILE_MODE 0666
+
+struct solution_cache{
+	int fd;
+	unsigned char *data; /*The whole file*/
+	size_t size;
+	unsigned long slots;
+	size_t slot_size;
+	pthread_mutex_t lock; /*Serializes the writers of this process, the file lock only does between processes*/
+};
+
+/*Locks or unlocks (type is F_WRLCK or F_UNLCK) the whole file for the writers of all processes*/
+void lock_cache_file(int fd, short type){
+	struct flock fl;
+	memset(&fl,0,sizeof(fl));
+	fl.l_type=type;
+	fl.l_whence=SEEK_SET;
+	while(fcntl(fd,F_SETLKW,&fl)<0 && errno==EINTR);
+}
+
+/*Writes the header of a new cache file and gives it its full size, returns 0 on failure*/
+char init_cache_file(int fd){
+	unsigned char header[CACHE_HEADER_SIZE];
+	memcpy(header,CACHE_MAGIC,4);
+	encode_number(header+4,CACHE_VERSION,4);
+	encode_number(header+8,CACHE_SLOTS,4);
+	encode_number(header+12,CACHE_SLOT_SIZE,4);
+	if(ftruncate(fd,CACHE_HEADER_SIZE+(off_t)CACHE_SLOTS*CACHE_SLOT_SIZE))
+		return 0;
+	return pwrite(fd,header,CACHE_HEADER_SIZE,0)==CACHE_HEADER_SIZE;
+}
+
+/*Reads the header of the cache file into cache, returns 0 if it isn't a cache file of this version*/
+char read_cache_header(solution_cache *cache, size_t size){
+	unsigned char header[CACHE_HEADER_SIZE];
+	if(size<CACHE_HEADER_SIZE || pread(cache->fd,header,CACHE_HEADER_SIZE,0)!=CACHE_HEADER_SIZE)
+		return 0;
+	if(memcmp(header,CACHE_MAGIC,4) || decode_number(header+4,4)!=CACHE_VERSION)
+		return 0;
+	cache->slots=decode_number(header+8,4);
+	cache->slot_size=decode_number(header+12,4);
+	return cache->slots && !(cache->slots&(cache->slots-1)) && cache->slot_size>SLOT_HEADER_SIZE
+			&& (size-CACHE_HEADER_SIZE)/cache->slot_size==cache->slots && (size-CACHE_HEADER_SIZE)%cache->slot_size==0;
+}
+
+/*Opens the cache file at path, creating it if it doesn't exist, see solution_cache.h*/
+solution_cache *open_cache(char *path){
+	solution_cache *cache;
+	struct stat st;
+	char valid;
+	cache=(solution_cache*)malloc(sizeof(solution_cache));
+	if(cache==NULL) function_error(f_malloc);
+	cache->fd=open(path,O_RDWR|O_CREAT,FILE_MODE);
+	if(cache->fd<0){
+		free(cache);
+		return NULL;
+	}
+	lock_cache_file(cache->fd,F_WRLCK); /*So only one process creates the file*/
+	valid=!fstat(cache->fd,&st) && S_ISREG(st.st_mode);
+	if(valid && st.st_size==0)
+		valid=init_cache_file(cache->fd) && !fstat(cache->fd,&st);
+	valid=valid && read_cache_header(cache,st.st_size);
+	lock_cache_file(cache->fd,F_UNLCK);
+	if(!valid){
+		close(cache->fd);
+		free(cache);
+		return NULL;
+	}
+	cache->size=st.st_size;
+	cache->data=(unsigned char*)mmap(NULL,cache->size,PROT_READ|PROT_WRITE,MAP_SHARED,cache->fd,0);
+	if(cache->data==MAP_FAILED) function_error(f_mmap);
+	pthread_mutex_init(&cache->lock,NULL);
+	return cache;
+}
+
+/*Writes the key of the board to buffer and returns its size, 0 if the key and a solution don't fit in a slot
+ * The key is the canonical form, back is set to the transformation from it to the board
+ * buffer holds slot_size bytes*/
+size_t make_key(solution_cache *cache, game_board *board, unsigned char *buffer, board_transform *back){
+	game_board key,canonical;
+	size_t size=binary_record_size(board);
+	if(!size || SLOT_HEADER_SIZE+2*size>cache->slot_size)
+		return 0;
+	key=create_board(board->block_rows,board->block_columns);
+	canonical=create_board(board->block_rows,board->block_columns);
+	copy_board(board,&key);
+	fix_all_cells(&key);
+	canonical_form(&key,&canonical,back);
+	encode_board(&canonical,buffer);
+	free_board(&key);
+	free_board(&canonical);
+	return size;
+}
+
+/*Returns the hash of a key, never 0 since 0 marks an empty slot*/
+unsigned long key_hash(unsigned char *key, size_t size){
+	unsigned long h=record_hash(key,size);
+	return h?h:1;
+}
+
+/*Copies slot number i to copy, and returns 1 if it holds the given key and isn't torn by a writer*/
+char read_slot(solution_cache *cache, unsigned long i, unsigned char *copy, unsigned char *key, size_t size, unsigned long hash){
+	memcpy(copy,cache->data+CACHE_HEADER_SIZE+i*cache->slot_size,cache->slot_size);
+	return decode_number(copy,4)==hash && decode_number(copy+4,4)==record_hash(copy+8,cache->slot_size-8)
+			&& decode_number(copy+14,2)==size && !memcmp(copy+SLOT_HEADER_SIZE,key,size);
+}
+
+/*Looks the board up in the cache, see solution_cache.h*/
+char cache_lookup(solution_cache *cache, game_board *board, cache_entry *entry){
+	unsigned char *key,*copy;
+	unsigned long hash,i,probe;
+	size_t size;
+	board_transform back;
+	game_board solution;
+	char found=0;
+	key=(unsigned char*)malloc(cache->slot_size*2);
+	if(key==NULL) function_error(f_malloc);
+	copy=key+cache->slot_size;
+	back=create_transform(board->block_rows,board->block_columns);
+	size=make_key(cache,board,key,&back);
+	if(size){
+		hash=key_hash(key,size);
+		for(probe=0;probe<MAX_PROBES && !found;probe++){
+			i=(hash+probe)&(cache->slots-1);
+			found=read_slot(cache,i,copy,key,size,hash);
+			if(!found && decode_number(copy,4)==0) /*The key would have been put in this empty slot*/
+				break;
+		}
+	}
+	if(found){
+		entry->solutions=(int)decode_number(copy+8,4)-1;
+		entry->solvable=copy[12]-1;
+		entry->solution.block_rows=0;
+		entry->solution.block_columns=0;
+		if(copy[13]){ /*The solution is kept for the canonical form*/
+			solution=decode_board(copy+SLOT_HEADER_SIZE+size);
+			if(solution.block_rows){
+				entry->solution=create_board(board->block_rows,board->block_columns);
+				apply_transform(&back,&solution,&entry->solution);
+				free_board(&solution);
+			}
+		}
+	}
+	free_transform(&back);
+	free(key);
+	return found;
+}
+
+/*Adds what entry says about the board to the cache, see solution_cache.h
+ * The new slot is built aside and copied over the old one, readers catch a partial copy with the checksum*/
+void cache_store(solution_cache *cache, game_board *board, cache_entry *entry){
+	unsigned char *key,*slot,*target;
+	unsigned long hash,i,probe;
+	size_t size;
+	int solutions,solvable;
+	board_transform back,forward;
+	game_board solution;
+	char found=0;
+	key=(unsigned char*)malloc(cache->slot_size*2);
+	if(key==NULL) function_error(f_malloc);
+	slot=key+cache->slot_size;
+	back=create_transform(board->block_rows,board->block_columns);
+	size=make_key(cache,board,key,&back);
+	if(!size){
+		free_transform(&back);
+		free(key);
+		return;
+	}
+	hash=key_hash(key,size);
+	pthread_mutex_lock(&cache->lock);
+	lock_cache_file(cache->fd,F_WRLCK);
+	for(probe=0;probe<MAX_PROBES;probe++){
+		i=(hash+probe)&(cache->slots-1);
+		found=read_slot(cache,i,slot,key,size,hash);
+		if(found || decode_number(slot,4)==0)
+			break;
+	}
+	if(probe==MAX_PROBES) /*Every slot is taken by another board*/
+		i=hash&(cache->slots-1);
+	if(!found)
+		memset(slot,0,cache->slot_size);
+	solutions=(entry->solutions!=CACHE_UNKNOWN)?entry->solutions:(int)decode_number(slot+8,4)-1;
+	solvable=(entry->solvable!=CACHE_UNKNOWN)?entry->solvable:slot[12]-1;
+	if(solutions!=CACHE_UNKNOWN)
+		solvable=(solutions>0);
+	encode_number(slot,hash,4);
+	encode_number(slot+8,(unsigned long)(solutions+1),4);
+	slot[12]=(unsigned char)(solvable+1);
+	encode_number(slot+14,size,2);
+	memcpy(slot+SLOT_HEADER_SIZE,key,size);
+	if(entry->solution.block_rows){ /*Kept for the canonical form, like the key*/
+		forward=create_transform(board->block_rows,board->block_columns);
+		solution=create_board(board->block_rows,board->block_columns);
+		invert_transform(&back,&forward);
+		apply_transform(&forward,&entry->solution,&solution);
+		encode_board(&solution,slot+SLOT_HEADER_SIZE+size);
+		slot[13]=1;
+		free_transform(&forward);
+		free_board(&solution);
+	}
+	encode_number(slot+4,record_hash(slot+8,cache->slot_size-8),4);
+	target=cache->data+CACHE_HEADER_SIZE+i*cache->slot_size;
+	memcpy(target+4,slot+4,cache->slot_size-4);
+	memcpy(target,slot,4); /*The hash goes last, so a reader looking for another key may stop here only once the slot is taken*/
+	lock_cache_file(cache->fd,F_UNLCK);
+	pthread_mutex_unlock(&cache->lock);
+	free_transform(&back);
+	free(key);
+}
+
+/*Unmaps and closes the cache file*/
+void close_cache(solution_cache *cache){
+	munmap(cache->data,cache->size);
+	close(cache->fd);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
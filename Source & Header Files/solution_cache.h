@@ -0,0 +1,47 @@
+/*This module keeps what the solvers found out about boards in a file that outlives the process,
+ * so a board that was solved once (by any run of the program) doesn't have to be solved again
+ *
+ * The file is a hash table of fixed-size slots with open addressing (linear probing), mapped to
+ * memory and shared by all the processes that use it:
+ * header:  "SDKC", version, slot count, slot size (32 bit each, little endian)
+ * slot:    key hash, checksum of the rest of the slot (32 bit each), solution count + 1 (32 bit,
+ *          0 if not counted), solvable + 1 (a byte, 0 if not known), whether a solution is kept
+ *          (a byte), key size (16 bit), the key and then the solution, as records of the binary format
+ * The key is the canonical form (see transform.h) of the board with every non-empty cell fixed, so the
+ * cache answers for the current values of a board, and boards that are transformations of each other
+ * share a slot. The solution is kept for the canonical form too
+ * Writers lock the file, readers don't: a slot is copied and then checked against its checksum and key,
+ * so a slot that is being written is just a miss*/
+
+#ifndef _SOLUTIONCACHEH_
+#define _SOLUTIONCACHEH_
+
+#include "board.h"
+
+#define CACHE_UNKNOWN -1
+
+typedef struct solution_cache solution_cache;
+
+/*What the cache knows about a board*/
+typedef struct cache_entry{
+	int solutions; /*Number of solutions, CACHE_UNKNOWN if they were never counted*/
+	int solvable; /*1 or 0, CACHE_UNKNOWN if never checked*/
+	game_board solution; /*A solution of the board, a 0x0 board if none is kept*/
+} cache_entry;
+
+/*Opens the cache file at path, creating it if it doesn't exist
+ * Returns NULL if the file cannot be used as a cache*/
+solution_cache *open_cache(char *path);
+
+/*Fills entry with what the cache knows about the board, returns 0 if the board isn't in the cache
+ * The caller frees the solution of the entry*/
+char cache_lookup(solution_cache *cache, game_board *board, cache_entry *entry);
+
+/*Adds what entry says about the board to the cache, keeping what the cache knew already
+ * Boards too large for a slot are not cached*/
+void cache_store(solution_cache *cache, game_board *board, cache_entry *entry);
+
+/*Unmaps and closes the cache file*/
+void close_cache(solution_cache *cache);
+
+#endif
@@ -0,0 +1,52 @@
+/*This module keeps the state a solver or generator call works with, so that calls on different
+ * contexts can run at the same time in different threads*/
+
+#include <stdlib.h>
+#include "error_handler.h"
+#include "solver_context.h"
+
+#define SEED_MASK 0xFFFFFFFFUL /*The generator works on 32 bits, unsigned long may be wider*/
+
+/*Creates a context whose random numbers are generated from seed*/
+solver_context create_context(unsigned long seed){
+	solver_context ctx;
+	ctx.seed=seed&SEED_MASK;
+	if(!ctx.seed) /*0 is the only state the generator never leaves*/
+		ctx.seed=1;
+	ctx.solutions=0;
+	ctx.limit=0;
+	ctx.steps=0;
+	ctx.cancelled=0;
+	ctx.aborted=0;
+	ctx.scratch=NULL;
+	ctx.scratch_size=0;
+	return ctx;
+}
+
+/*Returns a random number in [0,n) from the generator of the context (a 32 bit xorshift)*/
+int random_below(solver_context *ctx, int n){
+	unsigned long x=ctx->seed;
+	x^=(x<<13)&SEED_MASK;
+	x^=x>>17;
+	x^=(x<<5)&SEED_MASK;
+	ctx->seed=x;
+	return (int)(x%(unsigned long)n);
+}
+
+/*Returns the scratch memory of the context, growing it if it's smaller than size*/
+void* context_scratch(solver_context *ctx, size_t size){
+	if(size>ctx->scratch_size){
+		free(ctx->scratch);
+		ctx->scratch=malloc(size);
+		if(ctx->scratch==NULL) function_error(f_malloc);
+		ctx->scratch_size=size;
+	}
+	return ctx->scratch;
+}
+
+/*Frees the memory of the context*/
+void free_context(solver_context *ctx){
+	free(ctx->scratch);
+	ctx->scratch=NULL;
+	ctx->scratch_size=0;
+}
@@ -0,0 +1,34 @@
+/*This module keeps the state a solver or generator call works with, so that calls on different
+ * contexts can run at the same time in different threads*/
+
+#ifndef _SOLVERCONTEXTH_
+#define _SOLVERCONTEXTH_
+
+#include <stddef.h>
+
+/*A struct that holds everything a search changes while it runs
+ * A context must not be used by two calls at the same time*/
+typedef struct solver_context{
+	unsigned long seed; /*State of the random number generator, never 0*/
+	int solutions; /*Number of solutions found by the last count*/
+	int limit; /*A count stops once it found this many solutions, 0 means no limit*/
+	volatile long steps; /*Search steps taken since the context was created, read by other threads for progress reports*/
+	volatile int cancelled; /*Set (possibly from another thread) to stop the search, the caller clears it*/
+	volatile int aborted; /*Set by a search that stopped early because it was cancelled, the caller clears it*/
+	void *scratch; /*Memory reused by the searches, see context_scratch*/
+	size_t scratch_size;
+} solver_context;
+
+/*Creates a context whose random numbers are generated from seed*/
+solver_context create_context(unsigned long seed);
+
+/*Returns a random number in [0,n) from the generator of the context*/
+int random_below(solver_context *ctx, int n);
+
+/*Returns the scratch memory of the context, at least size bytes of it*/
+void* context_scratch(solver_context *ctx, size_t size);
+
+/*Frees the memory of the context*/
+void free_context(solver_context *ctx);
+
+#endif
@@ -3,7 +3,6 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "parser.h"
 #include "error_handler.h"
 #include "stack_tools.h"
 
@@ -47,13 +46,3 @@ void *pop(Stack *stk)
 	stk->size--; /*Decrement stack size*/
 	return res;
 }
-
-/*Used to empty ONLY stacks containing commandInfo structs (i.e, undo/redo stacks)*/
-void empty_stack(Stack *stk)
-{
-	commandInfo *com;
-	while(stk->size){
-			com=(commandInfo*)pop(stk);
-			free_command(com);
-		}
-}
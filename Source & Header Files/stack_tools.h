@@ -21,4 +21,3 @@ typedef struct Stack{
 Stack create_stack(); /*Initalizes an empty stack and returns it*/
 void push(Stack *stk, void *info); /*Pushes info on top of the stack stk*/
 void *pop(Stack *stk);/*Returns the element on top of the stack. If the stack is empty, returns NULL*/
-void empty_stack(Stack *stk); /*Used to empty ONLY stacks containing commandInfo structs (i.e, undo/redo stacks)*/
@@ -0,0 +1,159 @@
+/*This module runs the -stress mode, see stress_test.h*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "board.h"
+#include "parser.h"
+#include "error_handler.h"
+#include "solver_context.h"
+#include "exhaustive_solver.h"
+#include "ILPsolver.h"
+#include "generator.h"
+#include "batch.h"
+#include "stress_test.h"
+
+#define STRESS_ARGS 3 /*program name, -stress and the number of boards*/
+#define STRESS_SEED 1 /*The boards are the same on every run*/
+#define STRESS_BLOCK_ROWS 3
+#define STRESS_BLOCK_COLUMNS 3
+#define STRESS_X 20 /*Same meaning as the arguments of the generate command*/
+#define STRESS_Y 30 /*Few enough fixed cells that most boards have several solutions*/
+
+/*The results of the solvers on a single board*/
+typedef struct stress_result{
+	int solutions; /*Returned by count_solutions*/
+	char solved; /*Whether find_solution returned a valid solution of the board*/
+} stress_result;
+
+/*A struct that keeps what the threads of the test share, thread t solves the boards t, t+jobs, t+2*jobs...*/
+typedef struct stress_run{
+	game_board *boards;
+	stress_result *results;
+	int count,jobs;
+	int next_thread; /*Index of the next thread to start, taken under lock*/
+	pthread_mutex_t lock;
+} stress_run;
+
+/*Returns 1 if solution is a full board without errors that keeps every value of board*/
+char is_solution_of(game_board *solution, game_board *board){
+	int x,y,len;
+	if(solution->block_rows!=board->block_rows || solution->block_columns!=board->block_columns
+			|| solution->empty_cells || solution->errors)
+		return 0;
+	len=board_len(board);
+	for(x=0;x<len;x++){
+		for(y=0;y<len;y++){
+			if(board->cells[x][y].value && board->cells[x][y].value!=solution->cells[x][y].value)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+/*Runs both solvers on the board with the given context*/
+stress_result solve_stress_board(solver_context *ctx, game_board *board){
+	stress_result result;
+	game_board solution;
+	result.solutions=count_solutions(ctx,board);
+	solution=find_solution(ctx,board);
+	result.solved=is_solution_of(&solution,board);
+	if(solution.block_rows)
+		free_board(&solution);
+	return result;
+}
+
+/*The body of a thread of the test: solves its share of the boards with a context of its own*/
+void *run_stress_thread(void *arg){
+	stress_run *run=(stress_run*)arg;
+	solver_context ctx;
+	int i;
+	pthread_mutex_lock(&run->lock);
+	i=run->next_thread++;
+	pthread_mutex_unlock(&run->lock);
+	ctx=create_context(STRESS_SEED+i+1);
+	for(;i<run->count;i+=run->jobs)
+		run->results[i]=solve_stress_board(&ctx,&run->boards[i]);
+	free_context(&ctx);
+	return NULL;
+}
+
+/*Generates count boards of the test, they are the same on every run*/
+game_board *create_stress_boards(int count){
+	game_board *boards;
+	solver_context ctx;
+	int i;
+	boards=(game_board*)malloc(sizeof(game_board)*count);
+	if(boards==NULL) function_error(f_malloc);
+	ctx=create_context(STRESS_SEED);
+	for(i=0;i<count;i++){
+		boards[i]=create_board(STRESS_BLOCK_ROWS,STRESS_BLOCK_COLUMNS);
+		while(!generate_puzzle(&ctx,&boards[i],STRESS_X,STRESS_Y,0))
+			clear_board(&boards[i]);
+	}
+	free_context(&ctx);
+	return boards;
+}
+
+/*Solves <N> boards with -jobs <J> threads (one per core by default), then solves them again one by one
+ * and reports every board whose results differ*/
+int batch_stress(int argc, char *argv[]){
+	stress_run run;
+	stress_result serial;
+	solver_context ctx;
+	pthread_t *threads;
+	struct timespec start;
+	int i,mismatches=0;
+	run.count=(argc>=STRESS_ARGS)?string_to_int(argv[2]):0;
+	run.jobs=(int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(argc==STRESS_ARGS+2 && !strcmp(argv[STRESS_ARGS],"-jobs"))
+		run.jobs=string_to_int(argv[STRESS_ARGS+1]);
+	else if(argc!=STRESS_ARGS)
+		run.jobs=0;
+	if(run.count<=0 || run.jobs<=0){
+		printf("Usage: %s -stress <N> [-jobs <J>]\n",argv[0]);
+		return 1;
+	}
+	run.boards=create_stress_boards(run.count);
+	run.results=(stress_result*)malloc(sizeof(stress_result)*run.count);
+	threads=(pthread_t*)malloc(sizeof(pthread_t)*run.jobs);
+	if(run.results==NULL || threads==NULL) function_error(f_malloc);
+	run.next_thread=0;
+	pthread_mutex_init(&run.lock,NULL);
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	for(i=0;i<run.jobs;i++){
+		if(pthread_create(&threads[i],NULL,run_stress_thread,&run)) function_error(f_thread);
+	}
+	for(i=0;i<run.jobs;i++)
+		pthread_join(threads[i],NULL);
+	printf("Solved %d boards on %d threads in %.2f seconds\n",run.count,run.jobs,elapsed_seconds(&start));
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	ctx=create_context(STRESS_SEED);
+	for(i=0;i<run.count;i++){
+		serial=solve_stress_board(&ctx,&run.boards[i]);
+		if(serial.solutions!=run.results[i].solutions || serial.solved!=run.results[i].solved){
+			printf("Error: board %d has %d solutions (%s) serially, but %d (%s) on the threads\n",i,
+					serial.solutions,serial.solved?"solved":"not solved",
+					run.results[i].solutions,run.results[i].solved?"solved":"not solved");
+			mismatches++;
+		}
+	}
+	printf("Solved %d boards serially in %.2f seconds\n",run.count,elapsed_seconds(&start));
+	printf("%d of %d results differ\n",mismatches,run.count);
+
+	free_context(&ctx);
+	pthread_mutex_destroy(&run.lock);
+	for(i=0;i<run.count;i++)
+		free_board(&run.boards[i]);
+	free(run.boards);
+	free(run.results);
+	free(threads);
+	return mismatches?1:0;
+}
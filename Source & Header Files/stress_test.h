@@ -0,0 +1,6 @@
+/*This module runs the -stress mode, which checks that the solvers can run at the same time in different
+ * threads: the same boards are solved once one by one and once by several threads, and the results compared*/
+
+/*Runs the stress test given by the command line arguments
+ * Returns the exit status of the program, 1 if any result of the threads differs from the serial run*/
+int batch_stress(int argc, char *argv[]);
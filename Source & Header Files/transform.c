@@ -0,0 +1,371 @@
+/*This module handles validity preserving transformations of boards:
+ * relabeling the digits, permuting rows within a band of blocks, columns within
+ * a stack of blocks, and the bands and stacks themselves
+ * It also finds the canonical form of a board, the one board all its transformations share*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "solver_context.h"
+#include "error_handler.h"
+#include "transform.h"
+
+#define MAX_EXACT_LEN 9 /*Larger boards only get their digits relabeled*/
+#define MAX_EXACT_ORDERS 1296 /*Most row or column orders the exact search tries, those of a 9x9 board*/
+
+/*A struct that keeps the state of the search for the canonical form of a board
+ * A candidate is a column order and a row order, the digits are relabeled in the order they first appear,
+ * and the smallest resulting board (comparing the values row by row) is the canonical form*/
+typedef struct canon_search{
+	game_board *board;
+	int len,band_len; /*band_len is the number of rows in a band*/
+	int *columns; /*Column x of a candidate is column columns[x] of the board*/
+	int *rows; /*Row y of the current candidate is row rows[y] of the board*/
+	char *used; /*Rows already placed in the current candidate*/
+	int *labels; /*labels[d*(len+1)+v] is the label of v after placing d rows, 0 if v wasn't seen yet*/
+	int *next_label; /*next_label[d] is the label the next new value gets after placing d rows*/
+	char *equal; /*equal[d] is set if the first d rows of the candidate are the same as those of the best one*/
+	int *row; /*The relabeled row being placed*/
+	int *best; /*The best board found so far, row by row*/
+	int *best_rows,*best_columns,*best_labels;
+	char found; /*Set once there is a best board*/
+} canon_search;
+
+/*Allocates an array of len ints holding the identity permutation 0..len-1*/
+int *identity_map(int len){
+	int i,*map;
+	map=(int*)malloc(sizeof(int)*len);
+	if(map==NULL) function_error(f_malloc);
+	for(i=0;i<len;i++)
+		map[i]=i;
+	return map;
+}
+
+/*Creates the identity transformation for boards with the given block dimensions*/
+board_transform create_transform(int block_rows, int block_columns){
+	board_transform t;
+	int len;
+	len=block_rows*block_columns;
+	t.block_rows=block_rows;
+	t.block_columns=block_columns;
+	t.row_map=identity_map(len);
+	t.column_map=identity_map(len);
+	t.value_map=identity_map(len+1);
+	return t;
+}
+
+/*Randomly shuffles the len elements of arr (Fisher-Yates)*/
+void shuffle(solver_context *ctx, int *arr, int len){
+	int i,j,temp;
+	for(i=len-1;i>0;i--){
+		j=random_below(ctx,i+1);
+		temp=arr[i];
+		arr[i]=arr[j];
+		arr[j]=temp;
+	}
+}
+
+/*Fills map with a random permutation of groups_num groups of group_len consecutive lines,
+ * that only moves whole groups and lines within their group*/
+void random_grouped_map(solver_context *ctx, int *map, int groups_num, int group_len){
+	int *groups,*lines,group,line;
+	groups=identity_map(groups_num);
+	lines=identity_map(group_len);
+	shuffle(ctx,groups,groups_num);
+	for(group=0;group<groups_num;group++){
+		shuffle(ctx,lines,group_len);
+		for(line=0;line<group_len;line++)
+			map[group*group_len+line]=groups[group]*group_len+lines[line];
+	}
+	free(groups);
+	free(lines);
+}
+
+/*Makes t a random transformation
+ * Rows are grouped into bands of block_rows rows and columns into stacks of block_columns columns,
+ * so every block of the source ends up as a block of the target*/
+void random_transform(solver_context *ctx, board_transform *t){
+	int len;
+	len=t->block_rows*t->block_columns;
+	random_grouped_map(ctx,t->row_map,t->block_columns,t->block_rows);
+	random_grouped_map(ctx,t->column_map,t->block_rows,t->block_columns);
+	shuffle(ctx,t->value_map+1,len); /*0 must stay in place*/
+}
+
+/*Writes the transformed source to target
+ * The cells are written directly and the counters are rebuilt once at the end*/
+void apply_transform(board_transform *t, game_board *source, game_board *target){
+	int x,y,len;
+	game_cell *src,*dst;
+	len=board_len(source);
+	for(x=0;x<len;x++){
+		dst=target->cells[x];
+		src=source->cells[t->column_map[x]];
+		for(y=0;y<len;y++){
+			dst[y].value=t->value_map[src[t->row_map[y]].value];
+			dst[y].is_fixed=src[t->row_map[y]].is_fixed;
+		}
+	}
+	recount_board(target);
+}
+
+/*Frees the memory allocated for a transformation*/
+void free_transform(board_transform *t){
+	free(t->row_map);
+	free(t->column_map);
+	free(t->value_map);
+}
+
+/*Returns the number of orders of groups_num groups of group_len lines that keep the groups together,
+ * or MAX_EXACT_ORDERS+1 if there are more than MAX_EXACT_ORDERS of them*/
+long count_grouped_orders(int groups_num, int group_len){
+	long count=1;
+	int i,g;
+	for(i=2;i<=groups_num && count<=MAX_EXACT_ORDERS;i++)
+		count*=i;
+	for(g=0;g<groups_num;g++){
+		for(i=2;i<=group_len && count<=MAX_EXACT_ORDERS;i++)
+			count*=i;
+	}
+	return count<=MAX_EXACT_ORDERS?count:MAX_EXACT_ORDERS+1;
+}
+
+/*Makes arr the next permutation of its len elements in lexicographic order
+ * Returns 0 (leaving arr sorted) once it was the last one*/
+char next_permutation(int *arr, int len){
+	int i,j,temp;
+	for(i=len-2;i>=0 && arr[i]>=arr[i+1];i--);
+	if(i<0){
+		for(i=0,j=len-1;i<j;i++,j--){
+			temp=arr[i];
+			arr[i]=arr[j];
+			arr[j]=temp;
+		}
+		return 0;
+	}
+	for(j=len-1;arr[j]<=arr[i];j--);
+	temp=arr[i];
+	arr[i]=arr[j];
+	arr[j]=temp;
+	for(i++,j=len-1;i<j;i++,j--){
+		temp=arr[i];
+		arr[i]=arr[j];
+		arr[j]=temp;
+	}
+	return 1;
+}
+
+/*Makes map the next grouped order (see random_grouped_map) of groups_num groups of group_len lines,
+ * order holds the order of the groups followed by the order of the lines within every group
+ * Returns 0 once all of them were made*/
+char next_grouped_order(int *map, int *order, int groups_num, int group_len){
+	int g,line;
+	char more=0;
+	for(g=groups_num;g>=1 && !more;g--) /*An odometer: the last group's lines change fastest*/
+		more=next_permutation(order+groups_num+(g-1)*group_len,group_len);
+	if(!more)
+		more=next_permutation(order,groups_num);
+	for(g=0;g<groups_num;g++){
+		for(line=0;line<group_len;line++)
+			map[g*group_len+line]=order[g]*group_len+order[groups_num+g*group_len+line];
+	}
+	return more;
+}
+
+/*Returns 1 if two columns of the board are identical, so orders that only swap them give the same candidates*/
+char same_columns(game_board *board, int a, int b){
+	int y;
+	for(y=0;y<board_len(board);y++){
+		if(board->cells[a][y].value!=board->cells[b][y].value)
+			return 0;
+	}
+	return 1;
+}
+
+/*Returns 1 if the column order puts two identical columns of a stack out of their order on the board,
+ * such an order gives the same candidates as the one that doesn't*/
+char redundant_column_order(game_board *board, int *columns, int stack_len){
+	int x,prev;
+	for(x=0;x<board_len(board);x++){
+		for(prev=x-(x%stack_len);prev<x;prev++){
+			if(columns[prev]>columns[x] && same_columns(board,columns[prev],columns[x]))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/*Returns 1 if an unused row before row r in its band is identical to it
+ * Such rows can swap places in any candidate, so only the first of them needs to be tried*/
+char repeated_row(canon_search *cs, int r){
+	int prev,x;
+	char same=0;
+	for(prev=r-r%cs->band_len;prev<r && !same;prev++){
+		if(cs->used[prev])
+			continue;
+		for(same=1,x=0;x<cs->len && same;x++)
+			same=(cs->board->cells[x][prev].value==cs->board->cells[x][r].value);
+	}
+	return same;
+}
+
+/*Tries every row that may be row d of the current candidate, in the current column order
+ * A band is always completed before the next one starts, so the first row of a band may be any unused row*/
+void search_rows(canon_search *cs, int d){
+	int r,first,last,x,v,cmp;
+	int *labels,*next;
+	if(d==cs->len){ /*A whole candidate that is smaller than the best one, or the first one*/
+		memcpy(cs->best_rows,cs->rows,sizeof(int)*cs->len);
+		memcpy(cs->best_columns,cs->columns,sizeof(int)*cs->len);
+		memcpy(cs->best_labels,cs->labels+d*(cs->len+1),sizeof(int)*(cs->len+1));
+		memset(cs->equal,1,cs->len+1); /*The current candidate is the best one now*/
+		cs->found=1;
+		return;
+	}
+	first=0;
+	last=cs->len;
+	if(d%cs->band_len){ /*The band of the previous row continues*/
+		first=cs->rows[d-1]-cs->rows[d-1]%cs->band_len;
+		last=first+cs->band_len;
+	}
+	for(r=first;r<last;r++){
+		if(cs->used[r] || repeated_row(cs,r))
+			continue;
+		labels=cs->labels+(d+1)*(cs->len+1);
+		next=cs->next_label+d+1;
+		memcpy(labels,cs->labels+d*(cs->len+1),sizeof(int)*(cs->len+1));
+		*next=cs->next_label[d];
+		for(x=0;x<cs->len;x++){
+			v=cs->board->cells[cs->columns[x]][r].value;
+			if(v && !labels[v])
+				labels[v]=(*next)++;
+			cs->row[x]=labels[v];
+		}
+		cmp=0;
+		if(cs->found && cs->equal[d]){
+			for(x=0;x<cs->len && !cmp;x++)
+				cmp=cs->row[x]-cs->best[d*cs->len+x];
+			if(cmp>0) /*Every candidate with this row is larger than the best one*/
+				continue;
+		}
+		cs->equal[d+1]=cs->found && cs->equal[d] && !cmp;
+		/*The row goes straight into the best board, a smaller row always ends in a whole candidate that replaces it*/
+		memcpy(cs->best+d*cs->len,cs->row,sizeof(int)*cs->len);
+		cs->rows[d]=r;
+		cs->used[r]=1;
+		search_rows(cs,d+1);
+		cs->used[r]=0;
+	}
+}
+
+/*Allocates the memory of the search for the canonical form of board*/
+void init_search(canon_search *cs, game_board *board){
+	int len=board_len(board);
+	cs->board=board;
+	cs->len=len;
+	cs->band_len=board->block_rows;
+	cs->columns=identity_map(len);
+	cs->rows=identity_map(len);
+	cs->best_rows=identity_map(len);
+	cs->best_columns=identity_map(len);
+	cs->best_labels=(int*)calloc(len+1,sizeof(int));
+	cs->labels=(int*)calloc((len+1)*(len+1),sizeof(int));
+	cs->next_label=(int*)calloc(len+1,sizeof(int));
+	cs->row=(int*)calloc(len,sizeof(int));
+	cs->best=(int*)calloc(len*len,sizeof(int));
+	cs->used=(char*)calloc(len,1);
+	cs->equal=(char*)calloc(len+1,1);
+	if(cs->best_labels==NULL || cs->labels==NULL || cs->next_label==NULL || cs->row==NULL
+			|| cs->best==NULL || cs->used==NULL || cs->equal==NULL) function_error(f_calloc);
+	cs->found=0;
+}
+
+/*Frees the memory of the search*/
+void free_search(canon_search *cs){
+	free(cs->columns);
+	free(cs->rows);
+	free(cs->best_rows);
+	free(cs->best_columns);
+	free(cs->best_labels);
+	free(cs->labels);
+	free(cs->next_label);
+	free(cs->row);
+	free(cs->best);
+	free(cs->used);
+	free(cs->equal);
+}
+
+/*Tries every column order, and every row order with each, keeping the smallest candidate
+ * Orders that can only repeat candidates already tried are skipped*/
+void search_all_orders(canon_search *cs){
+	int *order,stacks,stack_len,i;
+	stacks=cs->board->block_rows;
+	stack_len=cs->board->block_columns;
+	order=(int*)malloc(sizeof(int)*(stacks+cs->len));
+	if(order==NULL) function_error(f_malloc);
+	for(i=0;i<stacks;i++)
+		order[i]=i;
+	for(i=0;i<cs->len;i++)
+		order[stacks+i]=i%stack_len;
+	do{
+		if(redundant_column_order(cs->board,cs->columns,stack_len))
+			continue;
+		cs->equal[0]=1;
+		cs->next_label[0]=1;
+		search_rows(cs,0);
+	}while(next_grouped_order(cs->columns,order,stacks,stack_len));
+	free(order);
+}
+
+/*Relabels the digits in the order they first appear, reading the board row by row*/
+void relabel_in_order(canon_search *cs){
+	int x,y,v,next=1;
+	for(y=0;y<cs->len;y++){
+		for(x=0;x<cs->len;x++){
+			v=cs->board->cells[x][y].value;
+			if(v && !cs->best_labels[v])
+				cs->best_labels[v]=next++;
+		}
+	}
+}
+
+/*Writes the inverse of t to inverse, both have the same dimensions*/
+void invert_transform(board_transform *t, board_transform *inverse){
+	int i,len;
+	len=t->block_rows*t->block_columns;
+	for(i=0;i<len;i++){
+		inverse->row_map[t->row_map[i]]=i;
+		inverse->column_map[t->column_map[i]]=i;
+	}
+	for(i=0;i<=len;i++)
+		inverse->value_map[t->value_map[i]]=i;
+}
+
+/*Writes the canonical form of board to canonical and the transformation that takes it back to board to back
+ * Boards of up to 9x9 (with at most 1296 row orders and column orders) get the smallest board of all their
+ * transformations, which is found with a pruned search. Larger boards only get their digits relabeled*/
+void canonical_form(game_board *board, game_board *canonical, board_transform *back){
+	canon_search cs;
+	board_transform t;
+	int v,next,len;
+	len=board_len(board);
+	init_search(&cs,board);
+	if(len<=MAX_EXACT_LEN && count_grouped_orders(board->block_rows,board->block_columns)<=MAX_EXACT_ORDERS
+			&& count_grouped_orders(board->block_columns,board->block_rows)<=MAX_EXACT_ORDERS)
+		search_all_orders(&cs);
+	else
+		relabel_in_order(&cs);
+	t=create_transform(board->block_rows,board->block_columns);
+	memcpy(t.row_map,cs.best_rows,sizeof(int)*len);
+	memcpy(t.column_map,cs.best_columns,sizeof(int)*len);
+	for(next=1,v=1;v<=len;v++){ /*The labels left for the missing values go in their order*/
+		if(cs.best_labels[v])
+			next++;
+	}
+	for(v=1;v<=len;v++)
+		t.value_map[v]=cs.best_labels[v]?cs.best_labels[v]:next++;
+	apply_transform(&t,board,canonical);
+	invert_transform(&t,back);
+	free_transform(&t);
+	free_search(&cs);
+}
@@ -0,0 +1,45 @@
+/*This module handles validity preserving transformations of boards:
+ * relabeling the digits, permuting rows within a band of blocks, columns within
+ * a stack of blocks, and the bands and stacks themselves
+ * It also finds the canonical form of a board, the one board all its transformations share*/
+
+#ifndef _TRANSFORMH_
+#define _TRANSFORMH_
+
+#include "board.h"
+#include "solver_context.h"
+
+/*A struct that represents a transformation of a board with the given block dimensions
+ * Cell <x,y> of a transformed board is cell <column_map[x],row_map[y]> of the source,
+ * with its value v replaced by value_map[v]*/
+typedef struct board_transform{
+	int block_rows,block_columns;
+	int *row_map;
+	int *column_map;
+	int *value_map; /*value_map[0] is always 0, so empty cells stay empty*/
+} board_transform;
+
+/*Creates the identity transformation for boards with the given block dimensions*/
+board_transform create_transform(int block_rows, int block_columns);
+
+/*Makes t a random transformation, any valid board stays valid under it
+ * The random choices are taken from ctx*/
+void random_transform(solver_context *ctx, board_transform *t);
+
+/*Writes the transformed source to target, keeping the fixed cells fixed
+ * Assumes both boards have the dimensions of the transformation*/
+void apply_transform(board_transform *t, game_board *source, game_board *target);
+
+/*Writes the inverse of t to inverse, both have the same dimensions*/
+void invert_transform(board_transform *t, board_transform *inverse);
+
+/*Writes the canonical form of board to canonical, and the transformation that takes the canonical form
+ * back to board to back. Both have the dimensions of board
+ * Boards that are transformations of each other have the same canonical form (exactly so for boards of up
+ * to 9x9, larger boards are only relabeled). The values decide the form, the fixed cells just follow them*/
+void canonical_form(game_board *board, game_board *canonical, board_transform *back);
+
+/*Frees the memory allocated for a transformation*/
+void free_transform(board_transform *t);
+
+#endif
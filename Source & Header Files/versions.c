@@ -0,0 +1,108 @@
+/*This module keeps every version of a board as a persistent tree
+ * A version is an array of column chunks, and a move copies only the columns it changed,
+ * sharing the rest with the version it was made from*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "history.h"
+#include "error_handler.h"
+#include "versions.h"
+
+#define INITIAL_CAPACITY 16
+
+/*Creates a chunk holding a copy of the cells of a column*/
+board_chunk* create_chunk(game_cell *column, int len){
+	board_chunk *chunk;
+	chunk=(board_chunk*)malloc(sizeof(board_chunk));
+	if(chunk==NULL) function_error(f_malloc);
+	chunk->cells=(game_cell*)malloc(sizeof(game_cell)*len);
+	if(chunk->cells==NULL) function_error(f_malloc);
+	memcpy(chunk->cells,column,sizeof(game_cell)*len);
+	chunk->refs=1;
+	return chunk;
+}
+
+/*Adds an empty version with the given parent and returns its id*/
+int new_version(version_store *s, int parent){
+	board_version *v;
+	if(s->count==s->capacity){
+		s->capacity*=2;
+		s->versions=(board_version*)realloc(s->versions,sizeof(board_version)*s->capacity);
+		if(s->versions==NULL) function_error(f_malloc);
+	}
+	v=&s->versions[s->count];
+	v->parent=parent;
+	v->columns=(board_chunk**)malloc(sizeof(board_chunk*)*s->len);
+	if(v->columns==NULL) function_error(f_malloc);
+	return s->count++;
+}
+
+/*Creates a version store whose first version is a copy of board*/
+version_store create_versions(game_board *board){
+	version_store s;
+	int x;
+	s.len=board_len(board);
+	s.count=0;
+	s.capacity=INITIAL_CAPACITY;
+	s.versions=(board_version*)malloc(sizeof(board_version)*s.capacity);
+	if(s.versions==NULL) function_error(f_malloc);
+	new_version(&s,-1);
+	for(x=0;x<s.len;x++)
+		s.versions[0].columns[x]=create_chunk(board->cells[x],s.len);
+	return s;
+}
+
+/*Adds a version made from parent by the given deltas, copying only the columns they touch*/
+int add_version(version_store *s, int parent, game_board *board, cell_delta *deltas, int count){
+	int id,i,x;
+	board_chunk **columns;
+	id=new_version(s,parent);
+	columns=s->versions[id].columns;
+	memcpy(columns,s->versions[parent].columns,sizeof(board_chunk*)*s->len);
+	for(x=0;x<s->len;x++)
+		columns[x]->refs++;
+	for(i=0;i<count;i++){
+		x=deltas[i].cell%s->len;
+		if(columns[x]!=s->versions[parent].columns[x]) /*Already copied for an earlier delta*/
+			continue;
+		columns[x]->refs--;
+		columns[x]=create_chunk(board->cells[x],s->len);
+	}
+	return id;
+}
+
+/*Returns a pointer to cell <x,y> in the given version*/
+game_cell* version_cell(version_store *s, int version, int x, int y){
+	return &s->versions[version].columns[x]->cells[y];
+}
+
+/*Returns 1 if column x is the same chunk in both versions*/
+char same_column(version_store *s, int first, int second, int x){
+	return s->versions[first].columns[x]==s->versions[second].columns[x];
+}
+
+/*Copies the cells of the given version to board*/
+void version_to_board(version_store *s, int version, game_board *board){
+	int x;
+	for(x=0;x<s->len;x++)
+		memcpy(board->cells[x],s->versions[version].columns[x]->cells,sizeof(game_cell)*s->len);
+	recount_board(board);
+}
+
+/*Frees the memory of all the versions, a chunk is freed with the last version that uses it*/
+void free_versions(version_store *s){
+	int i,x;
+	board_chunk *chunk;
+	for(i=0;i<s->count;i++){
+		for(x=0;x<s->len;x++){
+			chunk=s->versions[i].columns[x];
+			if(!--chunk->refs){
+				free(chunk->cells);
+				free(chunk);
+			}
+		}
+		free(s->versions[i].columns);
+	}
+	free(s->versions);
+}
@@ -0,0 +1,49 @@
+/*This module keeps every version of a board as a persistent tree
+ * A version is an array of column chunks, and a move copies only the columns it changed,
+ * sharing the rest with the version it was made from*/
+
+#ifndef _VERSIONSH_
+#define _VERSIONSH_
+
+#include "board.h"
+#include "history.h"
+
+/*A struct that holds the cells of one column, shared by all the versions that have the same column*/
+typedef struct board_chunk{
+	int refs; /*Number of versions that use the chunk*/
+	game_cell *cells; /*cells[y] is the cell in row y*/
+} board_chunk;
+
+/*A struct that represents a version of the board: its parent and its columns*/
+typedef struct board_version{
+	int parent; /*The version the version was made from, -1 for the first version*/
+	board_chunk **columns;
+} board_version;
+
+/*A struct that keeps all the versions of a game, version 0 is the board as it was loaded*/
+typedef struct version_store{
+	int len; /*Length of the board*/
+	board_version *versions;
+	int count,capacity;
+} version_store;
+
+/*Creates a version store whose first version is a copy of board*/
+version_store create_versions(game_board *board);
+
+/*Adds a version made from parent by the count given deltas, board is the board after them
+ * Returns the id of the new version*/
+int add_version(version_store *s, int parent, game_board *board, cell_delta *deltas, int count);
+
+/*Returns a pointer to cell <x,y> in the given version*/
+game_cell* version_cell(version_store *s, int version, int x, int y);
+
+/*Returns 1 if column x is the same chunk in both versions, i.e. the column is surely equal*/
+char same_column(version_store *s, int first, int second, int x);
+
+/*Copies the cells of the given version to board*/
+void version_to_board(version_store *s, int version, game_board *board);
+
+/*Frees the memory of all the versions*/
+void free_versions(version_store *s);
+
+#endif